@@ -0,0 +1,379 @@
+#include "include/qjs.hpp"
+#include "qjs/classbuilder.hpp"
+#include "qjs/compiledscript.hpp"
+#include "qjs/context_fwd.hpp"
+#include "qjs/functionlist.hpp"
+#include "qjs/msgpack.hpp"
+#include "qjs/overloads.hpp"
+#include "qjs/stringview.hpp"
+#include "qjs/runtime_fwd.hpp"
+#include "qjs/value_fwd.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <format>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+int Add(int a, int b) {
+    return a + b;
+}
+
+std::string Join(Qjs::JsStringView a, Qjs::JsStringView b) {
+    return std::string(a.View()) + std::string(b.View());
+}
+
+/// What `Overloads<Add, Join>` replaces: try each signature, and throw away the error when one doesn't fit.
+Qjs::Value AddOrJoin(Qjs::Value thisVal, std::vector<Qjs::Value> &args) {
+    Qjs::Context &ctx = thisVal.ctx;
+    Qjs::Value a = args.size() > 0 ? args[0] : Qjs::Value::Undefined(ctx);
+    Qjs::Value b = args.size() > 1 ? args[1] : Qjs::Value::Undefined(ctx);
+
+    auto intA = a.As<int>();
+    auto intB = b.As<int>();
+    if (intA.IsOk() && intB.IsOk())
+        return Qjs::Value::From(ctx, Add(intA.GetOk(), intB.GetOk()));
+    JS_FreeValue(ctx, JS_GetException(ctx));
+
+    auto strA = a.As<std::string>();
+    auto strB = b.As<std::string>();
+    if (strA.IsOk() && strB.IsOk())
+        return Qjs::Value::From(ctx, strA.GetOk() + strB.GetOk());
+
+    return Qjs::Value(ctx, JS_EXCEPTION);
+}
+
+size_t argsSeen = 0;
+
+Qjs::Value CountVector(Qjs::Value thisVal, std::vector<Qjs::Value> &args) {
+    argsSeen += args.size();
+    return Qjs::Value::Undefined(thisVal.ctx);
+}
+
+Qjs::Value CountArgs(Qjs::ValueRef thisVal, Qjs::Args args) {
+    argsSeen += args.Size();
+    return Qjs::Value::Undefined(thisVal.ctx);
+}
+
+template <bool TKeepIdentity>
+struct Node : public Qjs::UnmanagedClass {
+    int id = 0;
+};
+
+Node<true> keptNode;
+Node<false> freshNode;
+
+Node<true> *GetKeptNode() {
+    return &keptNode;
+}
+
+Node<false> *GetFreshNode() {
+    return &freshNode;
+}
+
+template <bool TPooled>
+struct Vec2 : public Qjs::ManagedClass {
+    double x, y;
+
+    Vec2(double x, double y) : x(x), y(y) {}
+};
+
+template <>
+struct Qjs::ClassAllocTraits<Vec2<true>> {
+    static constexpr bool Pooled = true;
+};
+
+struct Shape : public Qjs::ManagedClass {
+    double size = 1;
+
+    double Area() {
+        return size * size;
+    }
+};
+
+struct Padding {
+    double padding[2] = {};
+};
+
+struct Square : public Padding, public Shape {};
+
+/// Runs `src` as a global script. Returns the time it took, in nanoseconds.
+double Time(Qjs::Context &ctx, std::string const &src) {
+    auto script = Qjs::CompiledScript::Compile(ctx, src, "bench.js").GetOk();
+
+    auto start = std::chrono::steady_clock::now();
+    Qjs::Value res = script.Run();
+    auto end = std::chrono::steady_clock::now();
+
+    if (res.IsException())
+        std::println(std::cerr, "{}", res.ExceptionMessage());
+
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+void RunCallBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    global["add"] = Qjs::Value::Function<Add>(ctx, "add");
+
+    constexpr size_t Calls = 1'000'000;
+
+    double loop = Time(ctx, std::format("for (let i = 0; i < {}; i++) {{}}", Calls));
+    double ok = Time(ctx, std::format("for (let i = 0; i < {}; i++) add(i, i);", Calls));
+    double jsThrow = Time(ctx, std::format("for (let i = 0; i < {}; i++) try {{ null.x; }} catch {{}}", Calls));
+    double typeError = Time(ctx, std::format("for (let i = 0; i < {}; i++) try {{ add('x', i); }} catch {{}}", Calls));
+
+    std::println(std::cerr, "add(int, int): {:.1f} ns/call", (ok - loop) / Calls);
+    std::println(std::cerr, "add(int, int) type error: {:.1f} ns/call ({:.1f} ns over a JS throw)", (typeError - loop) / Calls, (typeError - jsThrow) / Calls);
+}
+
+void RunRawFunctionBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    global["countVector"] = Qjs::Value::RawFunction<CountVector>(ctx, "countVector");
+    global["countArgs"] = Qjs::Value::RawFunction<CountArgs>(ctx, "countArgs");
+
+    constexpr size_t Calls = 1'000'000;
+
+    double loop = Time(ctx, std::format("for (let i = 0; i < {}; i++) {{}}", Calls));
+    double vector = Time(ctx, std::format("for (let i = 0; i < {}; i++) countVector('a', i, i);", Calls));
+    double args = Time(ctx, std::format("for (let i = 0; i < {}; i++) countArgs('a', i, i);", Calls));
+
+    std::println(std::cerr, "raw function, std::vector<Value>: {:.1f} ns/call", (vector - loop) / Calls);
+    std::println(std::cerr, "raw function, Args: {:.1f} ns/call", (args - loop) / Calls);
+}
+
+void RunOverloadBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    global["overloaded"] = Qjs::Value::Overloads<Add, Join>(ctx, "overloaded");
+    global["byHand"] = Qjs::Value::RawFunction<AddOrJoin>(ctx, "byHand");
+
+    constexpr size_t Calls = 1'000'000;
+
+    double loop = Time(ctx, std::format("for (let i = 0; i < {}; i++) {{}}", Calls));
+    double first = Time(ctx, std::format("for (let i = 0; i < {}; i++) overloaded(i, i);", Calls));
+    double second = Time(ctx, std::format("for (let i = 0; i < {}; i++) overloaded('a', 'b');", Calls));
+    double firstByHand = Time(ctx, std::format("for (let i = 0; i < {}; i++) byHand(i, i);", Calls));
+    double secondByHand = Time(ctx, std::format("for (let i = 0; i < {}; i++) byHand('a', 'b');", Calls));
+
+    std::println(std::cerr, "overloads, first match: {:.1f} ns/call (by hand {:.1f})", (first - loop) / Calls, (firstByHand - loop) / Calls);
+    std::println(std::cerr, "overloads, second match: {:.1f} ns/call (by hand {:.1f})", (second - loop) / Calls, (secondByHand - loop) / Calls);
+}
+
+void RunArrayBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+
+    // Roughly the same number of elements for every size.
+    constexpr size_t Elements = 10'000'000;
+
+    for (size_t size : {size_t(10), size_t(1'000), size_t(1'000'000)}) {
+        size_t rounds = Elements / size;
+
+        std::vector<int> vec (size);
+        for (size_t i = 0; i < size; i++)
+            vec[i] = int(i);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; i++)
+            Qjs::Value::From(ctx, vec);
+        auto wrapped = std::chrono::steady_clock::now();
+
+        Qjs::Value arr = Qjs::Value::From(ctx, vec);
+        size_t total = 0;
+        for (size_t i = 0; i < rounds; i++)
+            total += arr.As<std::vector<int>>().GetOk().size();
+        auto unwrapped = std::chrono::steady_clock::now();
+
+        double wrapNs = std::chrono::duration<double, std::nano>(wrapped - start).count();
+        double unwrapNs = std::chrono::duration<double, std::nano>(unwrapped - wrapped).count();
+
+        std::println(std::cerr, "std::vector<int> of {}: wrap {:.2f} ns/element, unwrap {:.2f} ns/element ({} elements)", size, wrapNs / Elements, unwrapNs / Elements, total);
+    }
+}
+
+void RunIdentityBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    Qjs::ClassBuilder<Node<true>>(ctx, "KeptNode").KeepIdentity().Field<&Node<true>::id>("id").Build(global);
+    Qjs::ClassBuilder<Node<false>>(ctx, "FreshNode").Field<&Node<false>::id>("id").Build(global);
+
+    global["getKept"] = Qjs::Value::Function<GetKeptNode>(ctx, "getKept");
+    global["getFresh"] = Qjs::Value::Function<GetFreshNode>(ctx, "getFresh");
+
+    constexpr size_t Calls = 1'000'000;
+
+    double loop = Time(ctx, std::format("for (let i = 0; i < {}; i++) {{}}", Calls));
+    double kept = Time(ctx, std::format("for (let i = 0; i < {}; i++) getKept().id;", Calls));
+    double fresh = Time(ctx, std::format("for (let i = 0; i < {}; i++) getFresh().id;", Calls));
+
+    std::println(std::cerr, "same pointer, kept identity: {:.1f} ns/call", (kept - loop) / Calls);
+    std::println(std::cerr, "same pointer, new wrapper: {:.1f} ns/call", (fresh - loop) / Calls);
+}
+
+void RunAllocBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    Qjs::ClassBuilder<Vec2<true>>(ctx, "PooledVec2").Ctor<double, double>().Field<&Vec2<true>::x>("x").Build(global);
+    Qjs::ClassBuilder<Vec2<false>>(ctx, "HeapVec2").Ctor<double, double>().Field<&Vec2<false>::x>("x").Build(global);
+
+    constexpr size_t Objects = 1'000'000;
+
+    double loop = Time(ctx, std::format("for (let i = 0; i < {}; i++) {{}}", Objects));
+    double pooled = Time(ctx, std::format("for (let i = 0; i < {}; i++) new PooledVec2(i, i);", Objects));
+    double heap = Time(ctx, std::format("for (let i = 0; i < {}; i++) new HeapVec2(i, i);", Objects));
+    double kept = Time(ctx, std::format("const keep = []; for (let i = 0; i < {}; i++) keep.push(new PooledVec2(i, i));", Objects));
+
+    auto &stats = Qjs::ClassWrapper<Vec2<true>>::Pool(rt).GetStats();
+
+    std::println(std::cerr, "short-lived objects: pooled {:.1f} ns, new/delete {:.1f} ns", (pooled - loop) / Objects, (heap - loop) / Objects);
+    std::println(std::cerr, "kept objects, pooled: {:.1f} ns ({} slabs, {} bytes)", (kept - loop) / Objects, stats.slabs, stats.bytes);
+}
+
+void RunInheritanceBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    Qjs::ClassBuilder<Shape>(ctx, "Shape").Ctor<>().Method<&Shape::Area>("area").Build(global);
+    Qjs::ClassBuilder<Square>(ctx, "Square").Inherits<Shape>().Ctor<>().Build(global);
+
+    constexpr size_t Calls = 1'000'000;
+
+    double loop = Time(ctx, std::format("{{ const s = new Shape(); for (let i = 0; i < {}; i++) {{}} }}", Calls));
+    double base = Time(ctx, std::format("{{ const s = new Shape(); for (let i = 0; i < {}; i++) s.area(); }}", Calls));
+    double derived = Time(ctx, std::format("{{ const s = new Square(); for (let i = 0; i < {}; i++) s.area(); }}", Calls));
+
+    std::println(std::cerr, "base method on base instance: {:.1f} ns/call", (base - loop) / Calls);
+    std::println(std::cerr, "base method on derived instance: {:.1f} ns/call", (derived - loop) / Calls);
+}
+
+void RunClassSetupBench(Qjs::Runtime &rt) {
+    constexpr size_t Contexts = 1'000;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < Contexts; i++) {
+        Qjs::Context ctx {rt};
+        Qjs::ClassBuilder<Vec2<false>>(ctx, "Vec2")
+            .Ctor<double, double>()
+            .Field<&Vec2<false>::x>("x")
+            .Field<&Vec2<false>::y>("y")
+            .Method<Add>("m0")
+            .Method<Add>("m1")
+            .Method<Add>("m2")
+            .Method<Add>("m3")
+            .Method<Add>("m4")
+            .Method<Add>("m5")
+            .Method<Add>("m6")
+            .Method<Add>("m7")
+            .Build(Qjs::Value::Global(ctx));
+    }
+    auto chained = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < Contexts; i++) {
+        Qjs::Context ctx {rt};
+        Qjs::ClassBuilder<Vec2<false>>(ctx, "Vec2")
+            .Ctor<double, double>()
+            .Members<
+                Qjs::FieldEntry<"x", &Vec2<false>::x>,
+                Qjs::FieldEntry<"y", &Vec2<false>::y>,
+                Qjs::MethodEntry<"m0", Add>,
+                Qjs::MethodEntry<"m1", Add>,
+                Qjs::MethodEntry<"m2", Add>,
+                Qjs::MethodEntry<"m3", Add>,
+                Qjs::MethodEntry<"m4", Add>,
+                Qjs::MethodEntry<"m5", Add>,
+                Qjs::MethodEntry<"m6", Add>,
+                Qjs::MethodEntry<"m7", Add>
+            >()
+            .Build(Qjs::Value::Global(ctx));
+    }
+    auto listed = std::chrono::steady_clock::now();
+
+    auto us = [](auto from, auto to) {
+        return std::chrono::duration<double, std::micro>(to - from).count() / Contexts;
+    };
+
+    // Both include creating the context itself.
+    std::println(std::cerr, "class with 10 members: Method/Field {:.1f} us/context, Members {:.1f} us/context", us(start, chained), us(chained, listed));
+}
+
+void RunJsonBench(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+
+    constexpr size_t Rounds = 1'000;
+
+    // `Context::Eval` always runs modules, whose result is a promise, so this goes through a global script.
+    Qjs::Value doc = Qjs::CompiledScript::Compile(ctx,
+        "Array.from({length: 1000}, (_, i) => ({id: i, name: 'item ' + i, score: i / 7, tags: ['a', 'b', 'c'], active: i % 2 == 0}))",
+        "json.js"
+    ).GetOk().Run();
+
+    if (!JS_IsArray(ctx, doc)) {
+        std::println(std::cerr, "json bench: document isn't an array");
+        return;
+    }
+
+    std::string json;
+    std::vector<uint8_t> packed;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < Rounds; i++)
+        doc.ToJson(json).GetOk();
+    auto stringified = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < Rounds; i++) {
+        packed.clear();
+        Qjs::MsgPack::Encode(doc, packed).GetOk();
+    }
+    auto encoded = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < Rounds; i++)
+        Qjs::Value::ParseJson(ctx, json);
+    auto parsed = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < Rounds; i++)
+        Qjs::MsgPack::Decode(ctx, packed);
+    auto decoded = std::chrono::steady_clock::now();
+
+    auto us = [](auto from, auto to) {
+        return std::chrono::duration<double, std::micro>(to - from).count() / Rounds;
+    };
+
+    std::println(std::cerr, "JSON ({} bytes): stringify {:.1f} us, parse {:.1f} us", json.size(), us(start, stringified), us(encoded, parsed));
+    std::println(std::cerr, "MessagePack ({} bytes): encode {:.1f} us, decode {:.1f} us", packed.size(), us(stringified, encoded), us(parsed, decoded));
+}
+
+int main(int argc, char **argv) {
+    Qjs::Runtime rt;
+    std::println(std::cerr, "call bench begin");
+    RunCallBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "raw function bench begin");
+    RunRawFunctionBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "overload bench begin");
+    RunOverloadBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "array bench begin");
+    RunArrayBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "identity bench begin");
+    RunIdentityBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "alloc bench begin");
+    RunAllocBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "inheritance bench begin");
+    RunInheritanceBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "class setup bench begin");
+    RunClassSetupBench(rt);
+    rt.Gc();
+    std::println(std::cerr, "json bench begin");
+    RunJsonBench(rt);
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "include/qjs.hpp"
+#include "qjs/compiledscript.hpp"
+#include "qjs/context_fwd.hpp"
+#include "qjs/runtime_fwd.hpp"
+#include "qjs/value_fwd.hpp"
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <utility>
+
+/// Lots of distinct bindings with the same shape, to see how much code each one costs.
+/// Build it with and without `QJS_CPP_SHARED_TRAMPOLINES` (the `qjs_cpp_bloat` and `qjs_cpp_bloat_shared` targets)
+/// and compare the binaries with `size`.
+constexpr size_t Bindings = 500;
+
+template <int N>
+int Offset(int a) {
+    return a + N;
+}
+
+template <size_t ...TIndices>
+void Bind(Qjs::Context &ctx, std::index_sequence<TIndices...>) {
+    auto global = Qjs::Value::Global(ctx);
+    ((global[std::format("offset{}", TIndices)] = Qjs::Value::Function<Offset<int(TIndices)>>(ctx, std::format("offset{}", TIndices))), ...);
+}
+
+int main(int argc, char **argv) {
+    Qjs::Runtime rt;
+    Qjs::Context ctx {rt};
+
+    Bind(ctx, std::make_index_sequence<Bindings>());
+
+    constexpr size_t Calls = 1'000'000;
+
+    // The functions are looked up once, so the loop is mostly the calls themselves.
+    auto script = Qjs::CompiledScript::Compile(ctx, std::format(
+        "const fns = Array.from({{length: {1}}}, (_, i) => globalThis['offset' + i]);"
+        "let sum = 0; for (let i = 0; i < {0}; i++) sum += fns[i % {1}](i); sum",
+        Calls, Bindings
+    ), "bloat.js").GetOk();
+
+    auto start = std::chrono::steady_clock::now();
+    Qjs::Value res = script.Run();
+    auto end = std::chrono::steady_clock::now();
+
+    if (res.IsException()) {
+        std::println(std::cerr, "{}", res.ExceptionMessage());
+        return 1;
+    }
+
+    std::println(std::cerr, "{} bindings, {:.1f} ns/call", Bindings, std::chrono::duration<double, std::nano>(end - start).count() / Calls);
+
+    return 0;
+}
@@ -11,12 +11,30 @@
 #include "qjs/module.hpp" // IWYU pragma: export
 #include "qjs/classwrapper.hpp" // IWYU pragma: export
 #include "qjs/runtime.hpp" // IWYU pragma: export
+#include "qjs/bytecodecache.hpp" // IWYU pragma: export
+#include "qjs/mappedfile.hpp" // IWYU pragma: export
+#include "qjs/source.hpp" // IWYU pragma: export
+#include "qjs/bundle.hpp" // IWYU pragma: export
 #include "qjs/context.hpp" // IWYU pragma: export
+#include "qjs/compiledscript.hpp" // IWYU pragma: export
+#include "qjs/contextpool.hpp" // IWYU pragma: export
 #include "qjs/conversion.hpp" // IWYU pragma: export
+#include "qjs/typedarray.hpp" // IWYU pragma: export
+#include "qjs/stringview.hpp" // IWYU pragma: export
+#include "qjs/struct.hpp" // IWYU pragma: export
+#include "qjs/msgpack.hpp" // IWYU pragma: export
+#include "qjs/containerview.hpp" // IWYU pragma: export
+#include "qjs/iterator.hpp" // IWYU pragma: export
+#include "qjs/slabpool.hpp" // IWYU pragma: export
+#include "qjs/functionlist.hpp" // IWYU pragma: export
+#include "qjs/overloads.hpp" // IWYU pragma: export
+#include "qjs/gctrace.hpp" // IWYU pragma: export
+#include "qjs/sharedtrampolines.hpp" // IWYU pragma: export
 #include "qjs/value.hpp" // IWYU pragma: export
 #include "qjs/class.hpp" // IWYU pragma: export
 #include "qjs/classbuilder.hpp" // IWYU pragma: export
 #include "qjs/util.hpp" // IWYU pragma: export
+#include "qjs/propertykey.hpp" // IWYU pragma: export
 #include "qjs/functionwrapper.hpp" // IWYU pragma: export
 #include "qjs/result.hpp" // IWYU pragma: export
 #include "qjs/function.hpp" // IWYU pragma: export
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "qjs/mappedfile.hpp"
+#include "qjs/util.hpp"
+#include "quickjs.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Qjs {
+    /// A set of precompiled modules, as written by the `qjs_cpp_bundle` tool.
+    /// Register it with `Context::AddBundle` and imports of those names skip the parser.
+    ///
+    /// The bytes aren't copied, so the bundle has to outlive every context it's added to.
+    struct Bundle final {
+        struct Header {
+            char magic[8];
+            uint64_t version;
+            uint32_t count;
+            uint32_t reserved;
+        };
+
+        struct Entry {
+            uint64_t nameOffset;
+            uint64_t nameSize;
+            uint64_t dataOffset;
+            uint64_t dataSize;
+        };
+
+        static constexpr char Magic[8] = {'Q', 'J', 'S', 'C', 'P', 'P', 'B', 'N'};
+
+        struct Module {
+            std::string_view name;
+            std::span<uint8_t const> bytecode;
+        };
+
+        private:
+        std::shared_ptr<MappedFile const> file;
+        std::vector<Module> modules;
+
+        Bundle(std::shared_ptr<MappedFile const> &&file, std::vector<Module> &&modules) : file(std::move(file)), modules(std::move(modules)) {}
+
+        public:
+        static uint64_t Version() {
+            static uint64_t const version = [] {
+                char const *str = JS_GetVersion();
+                return Fnv1a(str, std::strlen(str));
+            }();
+            return version;
+        }
+
+        /// Reads a bundle from memory, e.g. an array from a generated header.
+        /// Fails if the data is malformed or was compiled by another engine version.
+        static std::optional<Bundle> FromMemory(std::span<uint8_t const> bytes, std::shared_ptr<MappedFile const> file = nullptr) {
+            if (bytes.size() < sizeof(Header))
+                return std::nullopt;
+
+            Header header;
+            std::memcpy(&header, bytes.data(), sizeof(Header));
+
+            if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version())
+                return std::nullopt;
+
+            if ((bytes.size() - sizeof(Header)) / sizeof(Entry) < header.count)
+                return std::nullopt;
+
+            std::vector<Module> modules;
+            modules.reserve(header.count);
+
+            for (uint32_t i = 0; i < header.count; i++) {
+                Entry entry;
+                std::memcpy(&entry, bytes.data() + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+
+                if (entry.nameOffset > bytes.size() || entry.nameSize > bytes.size() - entry.nameOffset)
+                    return std::nullopt;
+                if (entry.dataOffset > bytes.size() || entry.dataSize > bytes.size() - entry.dataOffset)
+                    return std::nullopt;
+
+                modules.push_back({
+                    {reinterpret_cast<char const *>(bytes.data() + entry.nameOffset), entry.nameSize},
+                    bytes.subspan(entry.dataOffset, entry.dataSize)
+                });
+            }
+
+            return Bundle(std::move(file), std::move(modules));
+        }
+
+        /// Maps a bundle file. The mapping lives as long as the returned bundle (and its copies).
+        static std::optional<Bundle> Open(std::filesystem::path const &path) {
+            auto mapped = MappedFile::Open(path);
+            if (!mapped)
+                return std::nullopt;
+
+            auto file = std::make_shared<MappedFile const>(std::move(*mapped));
+            std::span<uint8_t const> bytes {reinterpret_cast<uint8_t const *>(file->Data()), file->Size()};
+            return FromMemory(bytes, std::move(file));
+        }
+
+        std::span<Module const> Modules() const {
+            return modules;
+        }
+
+        /// Builds the serialized form of a bundle.
+        struct Writer final {
+            private:
+            std::vector<std::pair<std::string, std::vector<uint8_t>>> modules {};
+
+            static void Align(std::vector<uint8_t> &out) {
+                out.resize((out.size() + 7) / 8 * 8, 0);
+            }
+
+            public:
+            void Add(std::string name, std::vector<uint8_t> bytecode) {
+                modules.emplace_back(std::move(name), std::move(bytecode));
+            }
+
+            std::vector<uint8_t> Serialize() const {
+                Header header {};
+                std::memcpy(header.magic, Magic, sizeof(Magic));
+                header.version = Version();
+                header.count = modules.size();
+
+                std::vector<Entry> entries (modules.size());
+                std::vector<uint8_t> out (sizeof(Header) + entries.size() * sizeof(Entry), 0);
+
+                for (size_t i = 0; i < modules.size(); i++) {
+                    auto &[name, bytecode] = modules[i];
+
+                    entries[i].nameOffset = out.size();
+                    entries[i].nameSize = name.size();
+                    out.insert(out.end(), name.begin(), name.end());
+                    out.push_back(0);
+
+                    Align(out);
+                    entries[i].dataOffset = out.size();
+                    entries[i].dataSize = bytecode.size();
+                    out.insert(out.end(), bytecode.begin(), bytecode.end());
+                }
+
+                std::memcpy(out.data(), &header, sizeof(Header));
+                std::memcpy(out.data() + sizeof(Header), entries.data(), entries.size() * sizeof(Entry));
+
+                return out;
+            }
+        };
+    };
+}
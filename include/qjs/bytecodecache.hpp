@@ -0,0 +1,232 @@
+#pragma once
+
+#include "qjs/context_fwd.hpp"
+#include "qjs/mappedfile.hpp"
+#include "qjs/source.hpp"
+#include "qjs/util.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Qjs {
+    /// Keeps compiled module bytecode around so that importing the same module again doesn't hit the parser.
+    /// Entries are keyed by the module name, its source and the engine version, so edited sources
+    /// and engine upgrades just miss. Anything that fails validation or `JS_ReadObject` is dropped
+    /// and the module is compiled from source again.
+    ///
+    /// Install it with `Runtime::SetBytecodeCache`. One cache can be shared by several runtimes.
+    struct BytecodeCache final {
+        struct Stats {
+            size_t hits = 0;
+            size_t diskHits = 0;
+            size_t misses = 0;
+            size_t rejected = 0;
+        };
+
+        private:
+        struct Header {
+            char magic[8];
+            uint64_t key;
+            uint64_t version;
+            uint64_t size;
+            uint64_t checksum;
+        };
+
+        static constexpr char Magic[8] = {'Q', 'J', 'S', 'C', 'P', 'P', 'B', 'C'};
+
+        /// Either bytecode we wrote ourselves or a mapped cache file. `payload` points into one of them.
+        struct Entry {
+            std::vector<uint8_t> owned {};
+            std::optional<MappedFile> mapped {};
+            std::span<uint8_t const> payload {};
+        };
+
+        std::filesystem::path const dir;
+        std::unordered_map<uint64_t, Entry> entries {};
+        Stats stats {};
+
+        static uint64_t Version() {
+            static uint64_t const version = [] {
+                char const *str = JS_GetVersion();
+                return Fnv1a(str, std::strlen(str));
+            }();
+            return version;
+        }
+
+        static uint64_t Key(char const *src, size_t len, std::string const &name) {
+            uint64_t key = Fnv1a(name.c_str(), name.size() + 1);
+            key = Fnv1a(src, len, key);
+
+            uint64_t version = Version();
+            return Fnv1a(&version, sizeof(version), key);
+        }
+
+        std::filesystem::path PathFor(uint64_t key) const {
+            return dir / std::format("{:016x}.qjsbc", key);
+        }
+
+        /// Checks the header of a serialized entry. Returns the bytecode if it's usable.
+        static std::optional<std::span<uint8_t const>> Validate(std::span<uint8_t const> bytes, uint64_t key) {
+            if (bytes.size() < sizeof(Header))
+                return std::nullopt;
+
+            Header header;
+            std::memcpy(&header, bytes.data(), sizeof(Header));
+
+            if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.key != key || header.version != Version())
+                return std::nullopt;
+
+            auto payload = bytes.subspan(sizeof(Header));
+            if (payload.size() != header.size || Fnv1a(payload.data(), payload.size()) != header.checksum)
+                return std::nullopt;
+
+            return payload;
+        }
+
+        static std::optional<Value> Read(Context &ctx, std::span<uint8_t const> payload) {
+            Value mod = Value::CreateFree(ctx, JS_ReadObject(ctx, payload.data(), payload.size(), JS_READ_OBJ_BYTECODE));
+            if (mod.IsException()) {
+                JS_FreeValue(ctx, JS_GetException(ctx));
+                return std::nullopt;
+            }
+
+            if (mod.value.tag != JS_TAG_MODULE)
+                return std::nullopt;
+
+            return mod;
+        }
+
+        std::optional<Entry> LoadFile(uint64_t key) {
+            auto file = MappedFile::Open(PathFor(key));
+            if (!file)
+                return std::nullopt;
+
+            std::span<uint8_t const> bytes {reinterpret_cast<uint8_t const *>(file->Data()), file->Size()};
+            auto payload = Validate(bytes, key);
+            if (!payload) {
+                stats.rejected++;
+                return std::nullopt;
+            }
+
+            Entry entry {};
+            entry.mapped = std::move(file);
+            entry.payload = *payload;
+            return entry;
+        }
+
+        void StoreFile(uint64_t key, std::vector<uint8_t> const &bytes) {
+            std::error_code err;
+            std::filesystem::create_directories(dir, err);
+
+            auto path = PathFor(key);
+            auto tmp = path;
+            tmp += std::format(".{:x}.tmp", uintptr_t(this));
+
+            std::ofstream out (tmp, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return;
+
+            out.write(reinterpret_cast<char const *>(bytes.data()), bytes.size());
+            out.close();
+            if (!out) {
+                std::filesystem::remove(tmp, err);
+                return;
+            }
+
+            // Renaming keeps readers from ever seeing a half written file.
+            std::filesystem::rename(tmp, path, err);
+            if (err)
+                std::filesystem::remove(tmp, err);
+        }
+
+        public:
+        /// A cache that only lives in memory.
+        BytecodeCache() = default;
+
+        /// A cache that's also persisted to (and mapped from) `dir`.
+        BytecodeCache(std::filesystem::path dir) : dir(std::move(dir)) {}
+
+        BytecodeCache(BytecodeCache const &copy) = delete;
+
+        /// Same result as evaluating `src` with `JS_EVAL_FLAG_COMPILE_ONLY` as a module.
+        Value Compile(Context &ctx, Source const &src, std::string const &name) {
+            uint64_t key = Key(src.Data(), src.Size(), name);
+
+            if (auto it = entries.find(key); it != entries.end()) {
+                if (auto mod = Read(ctx, it->second.payload)) {
+                    stats.hits++;
+                    return *mod;
+                }
+
+                stats.rejected++;
+                entries.erase(it);
+            } else if (!dir.empty()) {
+                if (auto entry = LoadFile(key)) {
+                    if (auto mod = Read(ctx, entry->payload)) {
+                        stats.diskHits++;
+                        entries.insert({key, std::move(*entry)});
+                        return *mod;
+                    }
+
+                    stats.rejected++;
+                }
+            }
+
+            stats.misses++;
+
+            Value mod = Value::CreateFree(ctx, JS_Eval(ctx, src.Data(), src.Size(), name.c_str(), JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY));
+            if (mod.IsException())
+                return mod;
+
+            size_t size;
+            uint8_t *buf = JS_WriteObject(ctx, &size, mod, JS_WRITE_OBJ_BYTECODE);
+            if (!buf) {
+                JS_FreeValue(ctx, JS_GetException(ctx));
+                return mod;
+            }
+
+            Header header {};
+            std::memcpy(header.magic, Magic, sizeof(Magic));
+            header.key = key;
+            header.version = Version();
+            header.size = size;
+            header.checksum = Fnv1a(buf, size);
+
+            Entry entry {};
+            entry.owned.resize(sizeof(Header) + size);
+            std::memcpy(entry.owned.data(), &header, sizeof(Header));
+            std::memcpy(entry.owned.data() + sizeof(Header), buf, size);
+            js_free(ctx, buf);
+
+            entry.payload = std::span<uint8_t const>(entry.owned).subspan(sizeof(Header));
+
+            if (!dir.empty())
+                StoreFile(key, entry.owned);
+
+            entries.insert_or_assign(key, std::move(entry));
+
+            return mod;
+        }
+
+        /// Forgets every in-memory entry. Files on disk are left alone.
+        void Clear() {
+            entries.clear();
+        }
+
+        Stats const &GetStats() const {
+            return stats;
+        }
+    };
+}
@@ -6,7 +6,10 @@
 #include "qjs/value_fwd.hpp"
 #include "qjs/classwrapper_fwd.hpp"
 #include "qjs/class.hpp"
+#include "qjs/functionlist.hpp"
+#include "qjs/gctrace.hpp"
 #include "quickjs.h"
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include "module.hpp"
@@ -30,40 +33,60 @@ namespace Qjs {
                 return JS_ThrowPlainError(__ctx, "Whar");
             auto &ctx = *_ctx;
 
-            Value thisVal {ctx, this_val};
+            ValueRef thisVal {ctx, this_val};
             
             JsResult<std::tuple<std::decay_t<TArgs>...>> optArgs = UnpackWrapper<std::decay_t<TArgs>...>::UnpackArgs(ctx, thisVal, argc, argv);
 
             if (!optArgs.IsOk())
-                return optArgs.GetErr().ToUnmanaged();
+                return std::move(optArgs).GetErr().ToUnmanaged();
 
-            if constexpr (TPtr) {
-                T *value = std::apply(TCtorFunc, optArgs.GetOk());
+            static_assert(!TPtr || !ClassAllocTraits<T>::Pooled, "Pooled classes are allocated by ClassWrapper::Create; use Ctor instead.");
 
-                Value proto = thisVal.Prototype();
+            if constexpr (TPtr)
+                return Adopt(thisVal, std::apply(TCtorFunc, std::move(optArgs).GetOk()));
+            else
+                return Conversion<T>::Wrap(ctx, std::apply(TCtorFunc, std::move(optArgs).GetOk())).ToUnmanaged();
+        }
 
-                Value obj = Value::CreateFree(ctx, JS_NewObjectProtoClass(ctx, proto, ClassWrapper<T>::GetClassId(ctx.rt)));
+        /// `Ctor<TArgs...>()`: constructs with `ClassWrapper<T>::Create`, so pooled classes work.
+        template <typename ...TArgs>
+        static JSValue DefaultCtorInvoke(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx)
+                return JS_ThrowPlainError(__ctx, "Whar");
+            auto &ctx = *_ctx;
 
-                if (obj.IsException()) {
-                    delete value;
-                    return obj.ToUnmanaged();
-                }
+            ValueRef thisVal {ctx, this_val};
 
-                JS_SetOpaque(obj, value);
+            JsResult<std::tuple<TArgs...>> optArgs = UnpackWrapper<TArgs...>::UnpackArgs(ctx, thisVal, argc, argv);
 
-                return obj.ToUnmanaged();
-            } else {
-                return Conversion<T>::Wrap(ctx, std::apply(TCtorFunc, optArgs.GetOk())).ToUnmanaged();
-            }
+            if (!optArgs.IsOk())
+                return std::move(optArgs).GetErr().ToUnmanaged();
+
+            T *value = std::apply([&](auto &...args) { return ClassWrapper<T>::Create(ctx.rt, args...); }, optArgs.GetOk());
+            return Adopt(thisVal, value);
         }
 
         static JSValue NoCtorInvoke(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
             return JS_ThrowPlainError(ctx, "Class can't be constructed");
         }
 
-        template <typename ...TArgs>
-        static T *DefaultConstructor(TArgs &&...args) {
-            return new T(args...);
+        /// Wraps a new instance in an object with `new.target`'s prototype. The instance is destroyed if that fails.
+        static JSValue Adopt(ValueRef thisVal, T *value) {
+            Context &ctx = thisVal.ctx;
+
+            Value proto = thisVal.Prototype();
+
+            Value obj = Value::CreateFree(ctx, JS_NewObjectProtoClass(ctx, proto, ClassWrapper<T>::GetClassId(ctx.rt)));
+
+            if (obj.IsException()) {
+                ClassWrapper<T>::Destroy(ctx.rt, value);
+                return std::move(obj).ToUnmanaged();
+            }
+
+            ClassWrapper<T>::Attach(obj, value);
+
+            return std::move(obj).ToUnmanaged();
         }
     };
 
@@ -109,7 +132,9 @@ namespace Qjs {
 
         template <typename ...TArgs>
         ClassBuilder &Ctor() {
-            return CtorFun<CtorHelper<T>::template DefaultConstructor<TArgs...>>();
+            ctor = Value::CreateFree(ctx, JS_NewCFunction2(ctx, CtorHelper<T>::template DefaultCtorInvoke<std::decay_t<TArgs>...>, Name.c_str(), sizeof...(TArgs), JS_CFUNC_constructor, 0));
+            JS_SetConstructor(ctx, ctor, prototype);
+            return *this;
         }
 
         ClassBuilder &NoCtor() {
@@ -129,6 +154,39 @@ namespace Qjs {
         };
         public:
 
+        /// Reports the JS values held in `TMembers` (`Value`s, or vectors, maps and optionals of them) to the cycle
+        /// collector, so cycles through native objects get collected. List every traced member in one call, including
+        /// those of base classes; a later call replaces the list.
+        template <auto ...TMembers>
+        ClassBuilder &Traced() {
+            ClassWrapper<T>::markMembers = &TraceList<TMembers...>::template Mark<T>;
+            return *this;
+        }
+
+        /// Makes `T` a subclass of `TBase`: its prototype inherits from `TBase`'s, and instances can be passed
+        /// (and have `TBase`'s methods called on them) wherever a `TBase` is expected.
+        /// `TBase` has to be built in this context first, or this throws `std::logic_error`.
+        template <typename TBase>
+            requires (std::is_base_of_v<TBase, T> && !std::is_same_v<TBase, T>)
+        ClassBuilder &Inherits() {
+            if (!ClassWrapper<TBase>::HasProto(ctx))
+                throw std::logic_error("Build the base class before inheriting from it");
+
+            ClassWrapper<T>::template Inherit<TBase>(ctx.rt);
+
+            Value baseProto = Value::CreateFree(ctx, JS_GetClassProto(ctx, ClassWrapper<TBase>::GetClassId(ctx.rt)));
+            JS_SetPrototype(ctx, prototype, baseProto);
+
+            return *this;
+        }
+
+        /// Makes every conversion of the same `T *` give back the same JS object while it's alive,
+        /// instead of a new wrapper each time. The map is per context and doesn't keep wrappers alive.
+        ClassBuilder &KeepIdentity() {
+            ClassWrapper<T>::keepIdentity = true;
+            return *this;
+        }
+
         template <auto TField>
         ClassBuilder &Field(std::string &&name) {
             if constexpr (FieldTraits<TField>::IsConst)
@@ -153,6 +211,23 @@ namespace Qjs {
             return *this;
         }
 
+        /// A method that dispatches to one of several C++ methods by the arguments' types. See `OverloadWrapper`.
+        template <auto ...TFuns>
+        ClassBuilder &Overloads(std::string &&name) {
+            prototype[name] = Value::Overloads<TFuns...>(ctx, std::move(name));
+
+            return *this;
+        }
+
+        /// Installs a whole `FunctionList` of `MethodEntry`, `FieldEntry` and constant entries on the prototype at once.
+        /// Cheaper than `Method` and `Field` when a class is set up in many contexts.
+        template <typename ...TEntries>
+        ClassBuilder &Members() {
+            FunctionList<TEntries...>::Install(prototype);
+
+            return *this;
+        }
+
         void Build(Value object) {
             object[Name] = Value(ctor);
         }
@@ -192,6 +267,39 @@ namespace Qjs {
         };
         public:
 
+        /// Reports the JS values held in `TMembers` (`Value`s, or vectors, maps and optionals of them) to the cycle
+        /// collector, so cycles through native objects get collected. List every traced member in one call, including
+        /// those of base classes; a later call replaces the list.
+        template <auto ...TMembers>
+        ClassBuilder &Traced() {
+            ClassWrapper<T>::markMembers = &TraceList<TMembers...>::template Mark<T>;
+            return *this;
+        }
+
+        /// Makes `T` a subclass of `TBase`: its prototype inherits from `TBase`'s, and instances can be passed
+        /// (and have `TBase`'s methods called on them) wherever a `TBase` is expected.
+        /// `TBase` has to be built in this context first, or this throws `std::logic_error`.
+        template <typename TBase>
+            requires (std::is_base_of_v<TBase, T> && !std::is_same_v<TBase, T>)
+        ClassBuilder &Inherits() {
+            if (!ClassWrapper<TBase>::HasProto(ctx))
+                throw std::logic_error("Build the base class before inheriting from it");
+
+            ClassWrapper<T>::template Inherit<TBase>(ctx.rt);
+
+            Value baseProto = Value::CreateFree(ctx, JS_GetClassProto(ctx, ClassWrapper<TBase>::GetClassId(ctx.rt)));
+            JS_SetPrototype(ctx, prototype, baseProto);
+
+            return *this;
+        }
+
+        /// Makes every conversion of the same `T *` give back the same JS object while it's alive,
+        /// instead of a new wrapper each time. The map is per context and doesn't keep wrappers alive.
+        ClassBuilder &KeepIdentity() {
+            ClassWrapper<T>::keepIdentity = true;
+            return *this;
+        }
+
         template <auto TField>
         ClassBuilder &Field(std::string &&name) {
             if constexpr (FieldTraits<TField>::IsConst)
@@ -216,6 +324,23 @@ namespace Qjs {
             return *this;
         }
 
+        /// A method that dispatches to one of several C++ methods by the arguments' types. See `OverloadWrapper`.
+        template <auto ...TFuns>
+        ClassBuilder &Overloads(std::string &&name) {
+            prototype[name] = Value::Overloads<TFuns...>(ctx, std::move(name));
+
+            return *this;
+        }
+
+        /// Installs a whole `FunctionList` of `MethodEntry`, `FieldEntry` and constant entries on the prototype at once.
+        /// Cheaper than `Method` and `Field` when a class is set up in many contexts.
+        template <typename ...TEntries>
+        ClassBuilder &Members() {
+            FunctionList<TEntries...>::Install(prototype);
+
+            return *this;
+        }
+
         void Build(Value object) {
             object[Name] = Value(ctor);
         }
@@ -4,21 +4,33 @@
 #include "qjs/class.hpp"
 #include "quickjs.h"
 #include <type_traits>
+#include <utility>
 
 namespace Qjs {
     template <typename T>
     void ClassWrapper<T>::SetProto(Value proto) {
-        JS_SetClassProto(proto.ctx, GetClassId(proto.ctx.rt), proto.ToUnmanaged());
+        Context &ctx = proto.ctx;
+        ctx.classProtos.insert(GetClassId(ctx.rt));
+        JS_SetClassProto(ctx, GetClassId(ctx.rt), std::move(proto).ToUnmanaged());
     }
 
     template <typename T>
-    T *ClassWrapper<T>::Get(Value const &value) {
-        return static_cast<T *>(JS_GetOpaque(value, GetClassId(value.ctx.rt)));
+    T *ClassWrapper<T>::Get(ValueRef value) {
+        JSClassID id = JS_GetClassID(value);
+        if (id == GetClassId(value.ctx.rt))
+            return static_cast<T *>(JS_GetOpaque(value, id));
+
+        if (id >= derived.size() || !derived[id])
+            return nullptr;
+
+        auto ptr = static_cast<char *>(JS_GetOpaque(value, id));
+        return ptr ? reinterpret_cast<T *>(ptr + *derived[id]) : nullptr;
     }
 
     template <typename T>
-    bool ClassWrapper<T>::IsThis(Value const &value) {
-        return GetClassId(value.ctx.rt) == JS_GetClassID(value);
+    bool ClassWrapper<T>::IsThis(ValueRef value) {
+        JSClassID id = JS_GetClassID(value);
+        return id == GetClassId(value.ctx.rt) || (id < derived.size() && derived[id]);
     }
 
     template <typename T>
@@ -3,6 +3,12 @@
 #include "qjs/context_fwd.hpp"
 #include "qjs/value_fwd.hpp"
 #include "quickjs.h"
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace Qjs {
     template <typename T>
@@ -10,13 +16,71 @@ namespace Qjs {
         static constexpr bool ShouldDelete = true;
     };
 
+    /// Specialize with `Pooled = true` to allocate instances from a per-runtime `SlabPool` instead of `new`.
+    /// Instances then have to be created with `ClassWrapper<T>::Create` (which `ClassBuilder::Ctor` and the copying
+    /// conversion do), not by hand.
+    template <typename T>
+    struct ClassAllocTraits {
+        static constexpr bool Pooled = false;
+    };
+
+    /// How far a `TBase` is into a `TDerived`, in bytes. Only non-virtual bases have a fixed offset.
+    template <typename TDerived, typename TBase>
+        requires requires (TBase *base) { static_cast<TDerived *>(base); }
+    std::ptrdiff_t UpcastOffset() {
+        // Only the address is used, nothing is read, so the storage doesn't need an object in it.
+        alignas(TDerived) static char probe[sizeof(TDerived)];
+        return reinterpret_cast<char *>(static_cast<TBase *>(reinterpret_cast<TDerived *>(probe))) - probe;
+    }
+
     template <typename T>
     struct ClassWrapper {
         private:
+        template <typename>
+        friend struct ClassWrapper;
+
         inline static JSClassID classId = 0;
-        static inline std::vector<Value T::*> markOffsets;
+
+        /// Indexed by class id: where the `T` is in an instance of that (derived) class. Lets `IsThis` and `Get`
+        /// accept subclasses with one lookup, however deep the hierarchy is.
+        inline static std::vector<std::optional<std::ptrdiff_t>> derived;
+
+        struct Ancestor {
+            void (*addDerived)(JSClassID id, std::ptrdiff_t offset);
+            std::ptrdiff_t offset;
+        };
+
+        /// Every class `T` inherits from, directly or not, and where it is in a `T`.
+        inline static std::vector<Ancestor> ancestors;
+
+        static void AddDerived(JSClassID id, std::ptrdiff_t offset) {
+            if (derived.size() <= id)
+                derived.resize(id + 1);
+            derived[id] = offset;
+        }
+
+        static Value Wrap(Context &ctx, T *value) {
+            if (keepIdentity) {
+                if (auto it = ctx.rt.wrappers.find({ctx, GetClassId(ctx.rt), value}); it != ctx.rt.wrappers.end())
+                    return Value(ctx, it->second);
+            }
+
+            Value val = Value::CreateFree(ctx, JS_NewObjectClass(ctx, GetClassId(ctx.rt)));
+            if (val.IsException())
+                return val;
+
+            Attach(val, value);
+            return val;
+        }
 
         public:
+        /// Set by `ClassBuilder::KeepIdentity`. Wrapping the same pointer again then gives back the same object,
+        /// as long as that object is alive.
+        inline static bool keepIdentity = false;
+
+        /// Set by `ClassBuilder::Traced`. Reports the JS values an instance holds to the cycle collector.
+        inline static void (*markMembers)(JSRuntime *rt, T *ptr, JS_MarkFunc *mark_func) = nullptr;
+
         static JSClassID GetClassId(Runtime &rt) {
             if (classId != 0)
                 return classId;
@@ -25,12 +89,15 @@ namespace Qjs {
             return classId;
         }
 
-        static void RegisterClass(Context &ctx, std::string &&name, JSClassCall *invoker = nullptr) {
+        /// `exotic` is kept by the engine, so it has to live as long as the runtime (e.g. a static).
+        static void RegisterClass(Context &ctx, std::string &&name, JSClassCall *invoker = nullptr, JSClassExoticMethods *exotic = nullptr) {
             if (JS_IsRegisteredClass(ctx.rt, GetClassId(ctx.rt)))
                 return;
 
-            JSClassGCMark *marker = nullptr;
-            marker = [](JSRuntime *__rt, JSValue val, JS_MarkFunc *mark_func) {
+            JSClassGCMark *marker = [](JSRuntime *__rt, JSValue val, JS_MarkFunc *mark_func) {
+                if (!markMembers)
+                    return;
+
                 auto _rt = Runtime::From(__rt);
                 if (!_rt)
                     return;
@@ -40,27 +107,32 @@ namespace Qjs {
                 if (!ptr)
                     return;
 
-                for (Value T::*member : markOffsets)
-                    JS_MarkValue(rt, (*ptr.*member).value, mark_func);
+                markMembers(__rt, ptr, mark_func);
             };
 
             JSClassDef def{
                 name.c_str(),
                 [](JSRuntime *__rt, JSValue obj) noexcept {
-                    if (!ClassDeleteTraits<T>::ShouldDelete)
-                        return;
-
                     auto _rt = Runtime::From(__rt);
                     if (!_rt)
                         return;
                     auto &rt = *_rt;
                     
                     auto ptr = static_cast<T*>(JS_GetOpaque(obj, GetClassId(rt)));
-                    delete ptr;
+
+                    if (keepIdentity) {
+                        if (auto it = rt.wrapperKeys.find(JS_VALUE_GET_PTR(obj)); it != rt.wrapperKeys.end()) {
+                            rt.wrappers.erase(it->second);
+                            rt.wrapperKeys.erase(it);
+                        }
+                    }
+
+                    if (ClassDeleteTraits<T>::ShouldDelete)
+                        Destroy(rt, ptr);
                 },
                 marker,
                 invoker,
-                nullptr
+                exotic
             };
 
             JS_NewClass(ctx.rt, GetClassId(ctx.rt), &def);
@@ -68,14 +140,103 @@ namespace Qjs {
 
         static void SetProto(Value proto);
 
+        static SlabPool &Pool(Runtime &rt) {
+            return rt.Pool(GetClassId(rt), sizeof(T), alignof(T));
+        }
+
+        /// Allocates an instance the way the finalizer frees it.
+        template <typename ...TArgs>
+        static T *Create(Runtime &rt, TArgs &&...args) {
+            if constexpr (ClassAllocTraits<T>::Pooled) {
+                SlabPool &pool = Pool(rt);
+                void *block = pool.Allocate();
+                try {
+                    return new (block) T(std::forward<TArgs>(args)...);
+                } catch (...) {
+                    pool.Free(block);
+                    throw;
+                }
+            } else {
+                return new T(std::forward<TArgs>(args)...);
+            }
+        }
+
+        static void Destroy(Runtime &rt, T *ptr) {
+            if constexpr (ClassAllocTraits<T>::Pooled) {
+                if (!ptr)
+                    return;
+                ptr->~T();
+                Pool(rt).Free(ptr);
+            } else {
+                delete ptr;
+            }
+        }
+
+        /// Whether `SetProto` was called for this context yet. Class prototypes are per context.
+        static bool HasProto(Context &ctx) {
+            return ctx.classProtos.contains(GetClassId(ctx.rt));
+        }
+
+        /// Wraps an instance that's owned by the wrapper from now on. Instances of pooled classes come from the pool,
+        /// so they're created together with their wrapper by `Make` instead.
         static Value New(Context &ctx, T *value) {
-            Value val = Value::CreateFree(ctx, JS_NewObjectClass(ctx, GetClassId(ctx.rt)));
-            JS_SetOpaque(val, value);
+            static_assert(!ClassAllocTraits<T>::Pooled, "Instances of pooled classes can't be adopted from a pointer; use ClassWrapper::Make.");
+
+            return Wrap(ctx, value);
+        }
+
+        /// Creates an instance with `Create` and wraps it.
+        template <typename ...TArgs>
+        static Value Make(Context &ctx, TArgs &&...args) {
+            T *value = Create(ctx.rt, std::forward<TArgs>(args)...);
+
+            Value val = Wrap(ctx, value);
+            if (val.IsException())
+                Destroy(ctx.rt, value);
+
             return val;
         }
 
-        static bool IsThis(Value const &value);
+        /// Sets the native object of a freshly created wrapper, and remembers the wrapper if the class keeps identity.
+        static void Attach(ValueRef obj, T *value) {
+            JS_SetOpaque(obj, value);
+            if (!keepIdentity)
+                return;
+
+            Runtime &rt = obj.ctx.rt;
+            WrapperKey key {obj.ctx, GetClassId(rt), value};
+
+            // A wrapper this one replaces stays alive, but isn't handed out anymore.
+            if (auto it = rt.wrappers.find(key); it != rt.wrappers.end())
+                rt.wrapperKeys.erase(JS_VALUE_GET_PTR(it->second));
+
+            rt.wrappers.insert_or_assign(key, obj.value);
+            rt.wrapperKeys.insert_or_assign(JS_VALUE_GET_PTR(obj.value), key);
+        }
+
+        /// Lets instances of `T` pass as a `TBase`, and so as anything `TBase` inherits from. Bases have to be set
+        /// up before the classes that inherit from them.
+        template <typename TBase>
+        static void Inherit(Runtime &rt) {
+            auto add = &ClassWrapper<TBase>::AddDerived;
+            if (std::ranges::any_of(ancestors, [&](Ancestor const &ancestor) { return ancestor.addDerived == add; }))
+                return;
+
+            JSClassID id = GetClassId(rt);
+            std::ptrdiff_t offset = UpcastOffset<T, TBase>();
+
+            std::vector<Ancestor> added {{add, offset}};
+            for (auto const &ancestor : ClassWrapper<TBase>::ancestors)
+                added.push_back({ancestor.addDerived, offset + ancestor.offset});
+
+            for (Ancestor const &ancestor : added) {
+                ancestor.addDerived(id, ancestor.offset);
+                ancestors.push_back(ancestor);
+            }
+        }
+
+        static bool IsThis(ValueRef value);
 
-        static T *Get(Value const &value);
+        static T *Get(ValueRef value);
     };
 }
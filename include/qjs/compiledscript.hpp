@@ -0,0 +1,239 @@
+#pragma once
+
+#include "qjs/context_fwd.hpp"
+#include "qjs/function.hpp"
+#include "qjs/propertykey.hpp"
+#include "qjs/result_fwd.hpp"
+#include "qjs/source.hpp"
+#include "qjs/util.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Qjs {
+    /// Source that's parsed once and can be run any number of times.
+    ///
+    /// Global scripts keep their bytecode function around and just instantiate it on every run.
+    /// Modules can only be evaluated once, so for those the bytecode is serialized instead, and
+    /// every run reads a fresh module out of it. That still skips the parser, but each run leaves
+    /// a module record behind in the context.
+    struct CompiledScript final {
+        private:
+        Value bytecode;
+        std::vector<uint8_t> moduleBytecode;
+
+        CompiledScript(Value &&bytecode, std::vector<uint8_t> &&moduleBytecode) : bytecode(std::move(bytecode)), moduleBytecode(std::move(moduleBytecode)) {}
+
+        public:
+        /// `flags` are the same as for `JS_Eval`. Unlike `Context::Eval`, the default is a global script.
+        static JsResult<CompiledScript> Compile(Context &ctx, Source const &src, std::string const &file, int flags = JS_EVAL_TYPE_GLOBAL) {
+            Value bytecode = Value::CreateFree(ctx, JS_Eval(ctx, src.Data(), src.Size(), file.c_str(), flags | JS_EVAL_FLAG_COMPILE_ONLY));
+            if (bytecode.IsException())
+                return bytecode;
+
+            if ((flags & JS_EVAL_TYPE_MASK) != JS_EVAL_TYPE_MODULE)
+                return CompiledScript(std::move(bytecode), {});
+
+            size_t size;
+            uint8_t *buf = JS_WriteObject(ctx, &size, bytecode, JS_WRITE_OBJ_BYTECODE);
+            if (!buf)
+                return Value(ctx, JS_EXCEPTION);
+
+            std::vector<uint8_t> moduleBytecode (buf, buf + size);
+            js_free(ctx, buf);
+
+            return CompiledScript(Value::Undefined(ctx), std::move(moduleBytecode));
+        }
+
+        bool IsModule() const {
+            return !moduleBytecode.empty();
+        }
+
+        /// Runs the script. Module scripts return the evaluation promise, like `Context::Eval` does.
+        Value Run() {
+            Context &ctx = bytecode.ctx;
+
+            if (!IsModule())
+                return Value::CreateFree(ctx, JS_EvalFunction(ctx, bytecode.ToUnmanaged()));
+
+            JSValue mod = JS_ReadObject(ctx, moduleBytecode.data(), moduleBytecode.size(), JS_READ_OBJ_BYTECODE);
+            if (JS_IsException(mod))
+                return Value(ctx, JS_EXCEPTION);
+
+            if (JS_ResolveModule(ctx, mod) < 0) {
+                JS_FreeValue(ctx, mod);
+                return Value(ctx, JS_EXCEPTION);
+            }
+
+            return Value::CreateFree(ctx, JS_EvalFunction(ctx, mod));
+        }
+    };
+
+    /// Compiles a function body with named parameters into something that can be called directly,
+    /// without going back through the parser. Same as `new Function(...params, body)`: the parameters and
+    /// body are only parsed, so nothing in them runs until the function is called.
+    ///
+    /// ```
+    /// auto add = CompileFunction<double, double, double>(ctx, "return a + b;", {"a", "b"}).GetOk();
+    /// add(1, 2);
+    /// ```
+    template <typename TReturn, typename ...TArgs>
+    JsResult<Function<TReturn, TArgs...>> CompileFunction(Context &ctx, std::string_view body, std::initializer_list<std::string_view> params) {
+        // The intrinsic `Function`, taken from a fresh function's prototype rather than from the global.
+        Value fresh = Value::CreateFree(ctx, JS_NewCFunction(ctx, [](JSContext *, JSValue, int, JSValue *) { return JS_UNDEFINED; }, "", 0));
+        if (fresh.IsException())
+            return fresh;
+        Value proto = Value::CreateFree(ctx, JS_GetPrototype(ctx, fresh));
+        if (proto.IsException())
+            return proto;
+        Value ctor = *proto["constructor"_key];
+        if (ctor.IsException())
+            return ctor;
+
+        std::vector<Value> args;
+        args.reserve(params.size() + 1);
+        for (auto param : params)
+            args.push_back(Value::CreateFree(ctx, JS_NewStringLen(ctx, param.data(), param.size())));
+        args.push_back(Value::CreateFree(ctx, JS_NewStringLen(ctx, body.data(), body.size())));
+
+        std::vector<JSValue> argv;
+        argv.reserve(args.size());
+        for (auto &arg : args) {
+            if (arg.IsException())
+                return arg;
+            argv.push_back(arg);
+        }
+
+        Value fn = Value::CreateFree(ctx, JS_Call(ctx, ctor, JS_UNDEFINED, int(argv.size()), argv.data()));
+        if (fn.IsException())
+            return fn;
+
+        return fn.As<Function<TReturn, TArgs...>>();
+    }
+
+    /// Least-recently-used cache of compiled scripts and functions for one context, keyed by a hash of the source.
+    /// Lookups still hash (and compare) the source, but that's a lot cheaper than parsing it.
+    ///
+    /// Only global scripts are cached: every run of a module leaves another module record in the context.
+    struct ScriptCache final {
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+        };
+
+        private:
+        struct Entry {
+            uint64_t key;
+            int flags;
+            std::string file;
+            std::vector<std::string> params;
+            std::string source;
+            std::shared_ptr<CompiledScript> script;
+            std::optional<Value> function;
+        };
+
+        Context &ctx;
+        size_t const Capacity;
+        std::list<Entry> entries {};
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> byKey {};
+        Stats stats {};
+
+        /// The full source is compared as well, since a 64-bit hash of untrusted sources can be made to collide.
+        template <typename TMatches>
+        Entry *Find(uint64_t key, std::string_view src, TMatches &&matches) {
+            auto it = byKey.find(key);
+            if (it == byKey.end() || it->second->source != src || !matches(*it->second)) {
+                stats.misses++;
+                return nullptr;
+            }
+
+            stats.hits++;
+            entries.splice(entries.begin(), entries, it->second);
+            return &entries.front();
+        }
+
+        void Insert(Entry &&entry) {
+            if (auto it = byKey.find(entry.key); it != byKey.end()) {
+                entries.erase(it->second);
+                byKey.erase(it);
+            }
+
+            while (!entries.empty() && entries.size() >= Capacity) {
+                byKey.erase(entries.back().key);
+                entries.pop_back();
+                stats.evictions++;
+            }
+
+            entries.push_front(std::move(entry));
+            byKey.insert({entries.front().key, entries.begin()});
+        }
+
+        public:
+        ScriptCache(Context &ctx, size_t capacity) : ctx(ctx), Capacity(capacity) {}
+
+        ScriptCache(ScriptCache const &copy) = delete;
+
+        /// The script is shared with the cache, so hits don't copy it. `flags` can't select a module.
+        JsResult<std::shared_ptr<CompiledScript>> Script(Source const &src, std::string const &file, int flags = JS_EVAL_TYPE_GLOBAL) {
+            if ((flags & JS_EVAL_TYPE_MASK) == JS_EVAL_TYPE_MODULE)
+                return Value::ThrowTypeError(ctx, "ScriptCache can't cache modules");
+
+            uint64_t key = Fnv1a(file.c_str(), file.size() + 1);
+            key = Fnv1a(&flags, sizeof(flags), key);
+            key = Fnv1a(src.Data(), src.Size(), key);
+
+            auto matches = [&](Entry const &entry) {
+                return entry.script && entry.flags == flags && entry.file == file;
+            };
+
+            if (auto entry = Find(key, src, matches))
+                return entry->script;
+
+            auto res = CompiledScript::Compile(ctx, src, file, flags);
+            if (!res.IsOk())
+                return std::move(res).GetErr();
+
+            auto script = std::make_shared<CompiledScript>(std::move(res).GetOk());
+            Insert({key, flags, file, {}, std::string(std::string_view(src)), script, std::nullopt});
+            return script;
+        }
+
+        template <typename TReturn, typename ...TArgs>
+        JsResult<Qjs::Function<TReturn, TArgs...>> Function(std::string_view body, std::initializer_list<std::string_view> params) {
+            uint64_t key = Fnv1a("function:", 9);
+            for (auto param : params) {
+                key = Fnv1a(param.data(), param.size(), key);
+                key = Fnv1a(",", 1, key);
+            }
+            key = Fnv1a(body.data(), body.size(), key);
+
+            auto matches = [&](Entry const &entry) {
+                return entry.function && std::ranges::equal(entry.params, params);
+            };
+
+            if (auto entry = Find(key, body, matches))
+                return Qjs::Function<TReturn, TArgs...> {*entry->function};
+
+            auto res = CompileFunction<TReturn, TArgs...>(ctx, body, params);
+            if (res.IsOk())
+                Insert({key, 0, {}, std::vector<std::string>(params.begin(), params.end()), std::string(body), nullptr, res.GetOk().value});
+            return res;
+        }
+
+        Stats const &GetStats() const {
+            return stats;
+        }
+    };
+}
@@ -0,0 +1,362 @@
+#pragma once
+
+#include "qjs/classwrapper.hpp"
+#include "qjs/context_fwd.hpp"
+#include "qjs/conversion_fwd.hpp"
+#include "qjs/propertykey.hpp"
+#include "qjs/result_fwd.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace Qjs {
+    /// Containers a `ContainerView` shows as an array.
+    template <typename T>
+    concept ArrayLikeContainer = std::ranges::random_access_range<T> && std::ranges::sized_range<T>;
+
+    /// Containers a `ContainerView` shows as a plain object: maps with string keys.
+    template <typename T>
+    concept MapLikeContainer = requires (T &map, typename T::key_type const &key) {
+        typename T::mapped_type;
+        map.find(key) == map.end();
+    } && std::convertible_to<typename T::key_type const &, std::string_view> && std::constructible_from<typename T::key_type, std::string_view>;
+
+    /// Shows a C++ container to JS without converting it up front. Elements are converted when a script reads them,
+    /// so handing out a huge container costs the same as handing out an empty one.
+    ///
+    /// Random access ranges look like arrays (indices, `length`, and `Array.prototype` methods), maps with string keys
+    /// look like null-prototype objects. Every read converts again, so `view[0] !== view[0]` for object elements,
+    /// and changing a read element doesn't change the container. With `TWritable`, assigning an index or key converts the
+    /// value back and stores it (and `delete` erases map keys). Arrays keep their size either way.
+    ///
+    /// The view keeps `owner` alive for as long as JS can reach it.
+    template <typename TContainer, bool TWritable = false>
+        requires ArrayLikeContainer<TContainer> || MapLikeContainer<TContainer>
+    struct ContainerView final {
+        std::shared_ptr<TContainer> owner;
+    };
+
+    template <typename TContainer, bool TWritable>
+    struct Conversion<ContainerView<TContainer, TWritable>> final {
+        static constexpr bool Implemented = true;
+
+        using View = ContainerView<TContainer, TWritable>;
+        using Wrapper = ClassWrapper<View>;
+
+        static constexpr bool IsArray = ArrayLikeContainer<TContainer>;
+
+        using Element = decltype([] {
+            if constexpr (IsArray)
+                return std::type_identity<std::remove_reference_t<std::ranges::range_reference_t<TContainer>>> {};
+            else
+                return std::type_identity<std::remove_reference_t<decltype((std::declval<TContainer &>().begin()->second))>> {};
+        }())::type;
+
+        static_assert(!TWritable || !std::is_const_v<Element>, "Writable views need a mutable container.");
+
+        private:
+        /// The array index `prop` names, if any. Index atoms come back from the engine as strings, so only
+        /// canonical indices count: "1" does, "01", "+1" and "1.0" don't.
+        static JsResult<std::optional<size_t>> Index(Context &ctx, JSAtom prop) {
+            JSValue val = JS_AtomToValue(ctx, prop);
+            if (val.tag == JS_TAG_INT) {
+                int32_t index = val.u.int32;
+                return index >= 0 ? std::optional(size_t(index)) : std::nullopt;
+            }
+            if (!JS_IsString(val)) {
+                JS_FreeValue(ctx, val);
+                return std::optional<size_t>();
+            }
+
+            size_t size;
+            char const *str = JS_ToCStringLen(ctx, &size, val);
+            JS_FreeValue(ctx, val);
+            if (!str)
+                return Value::CreateFree(ctx, JS_EXCEPTION);
+
+            std::optional<size_t> index;
+            uint32_t parsed;
+            auto [end, err] = std::from_chars(str, str + size, parsed);
+            if (size != 0 && (str[0] != '0' || size == 1) && err == std::errc() && end == str + size && parsed != UINT32_MAX)
+                index = parsed;
+
+            JS_FreeCString(ctx, str);
+            return index;
+        }
+
+        /// The map key `prop` names. Symbols don't name any. Fails if the name can't be converted to a string.
+        static JsResult<std::optional<std::string>> Name(Context &ctx, JSAtom prop) {
+            JSValue val = JS_AtomToValue(ctx, prop);
+            if (val.tag == JS_TAG_SYMBOL) {
+                JS_FreeValue(ctx, val);
+                return std::optional<std::string>();
+            }
+
+            size_t size;
+            char const *str = JS_ToCStringLen(ctx, &size, val);
+            JS_FreeValue(ctx, val);
+            if (!str)
+                return Value::CreateFree(ctx, JS_EXCEPTION);
+
+            std::string name (str, size);
+            JS_FreeCString(ctx, str);
+            return std::optional(std::move(name));
+        }
+
+        /// The element `prop` names, or null if there's none.
+        static JsResult<Element *> Find(Context &ctx, TContainer &container, JSAtom prop) {
+            if constexpr (IsArray) {
+                auto index = Index(ctx, prop);
+                if (!index.IsOk())
+                    return std::move(index).GetErr();
+                if (!index.GetOk() || *index.GetOk() >= std::ranges::size(container))
+                    return nullptr;
+                return &std::ranges::begin(container)[*index.GetOk()];
+            } else {
+                auto name = Name(ctx, prop);
+                if (!name.IsOk())
+                    return std::move(name).GetErr();
+                if (!name.GetOk())
+                    return nullptr;
+
+                auto it = container.find(typename TContainer::key_type(std::string_view(*name.GetOk())));
+                return it == container.end() ? nullptr : &it->second;
+            }
+        }
+
+        static bool IsLength(Context &ctx, JSAtom prop) {
+            return IsArray && prop == ctx.rt.Key<"length">(ctx).atom;
+        }
+
+        static int Reject(JSContext *ctx, int flags, char const *message) {
+            if (!(flags & (JS_PROP_THROW | JS_PROP_THROW_STRICT)))
+                return 0;
+
+            JS_ThrowTypeError(ctx, "%s", message);
+            return -1;
+        }
+
+        static int GetOwnProperty(JSContext *__ctx, JSPropertyDescriptor *desc, JSValue obj, JSAtom prop) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx) {
+                JS_ThrowPlainError(__ctx, "Whar");
+                return -1;
+            }
+            auto &ctx = *_ctx;
+            auto &container = *Wrapper::Get(ValueRef(ctx, obj))->owner;
+
+            if (IsLength(ctx, prop)) {
+                if (desc) {
+                    desc->flags = 0;
+                    desc->value = JS_NewInt64(ctx, std::ranges::size(container));
+                    desc->getter = JS_UNDEFINED;
+                    desc->setter = JS_UNDEFINED;
+                }
+                return 1;
+            }
+
+            auto found = Find(ctx, container, prop);
+            if (!found.IsOk())
+                return -1;
+
+            Element *elem = found.GetOk();
+            if (!elem)
+                return 0;
+
+            // A null descriptor only asks whether the property exists.
+            if (desc) {
+                Value val = Value::From(ctx, std::as_const(*elem));
+                if (val.IsException())
+                    return -1;
+
+                desc->flags = JS_PROP_ENUMERABLE;
+                if constexpr (TWritable)
+                    desc->flags |= IsArray ? JS_PROP_WRITABLE : JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE;
+                desc->value = std::move(val).ToUnmanaged();
+                desc->getter = JS_UNDEFINED;
+                desc->setter = JS_UNDEFINED;
+            }
+            return 1;
+        }
+
+        static int GetOwnPropertyNames(JSContext *__ctx, JSPropertyEnum **ptab, uint32_t *plen, JSValue obj) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx) {
+                JS_ThrowPlainError(__ctx, "Whar");
+                return -1;
+            }
+            auto &ctx = *_ctx;
+            auto &container = *Wrapper::Get(ValueRef(ctx, obj))->owner;
+
+            size_t count = std::ranges::size(container) + (IsArray ? 1 : 0);
+            auto tab = static_cast<JSPropertyEnum *>(js_malloc(ctx, sizeof(JSPropertyEnum) * (count ? count : 1)));
+            if (!tab)
+                return -1;
+
+            uint32_t len = 0;
+            auto add = [&](JSAtom atom, bool enumerable) {
+                if (atom == JS_ATOM_NULL)
+                    return false;
+                tab[len].is_enumerable = enumerable;
+                tab[len].atom = atom;
+                len++;
+                return true;
+            };
+
+            bool ok = true;
+            if constexpr (IsArray) {
+                for (size_t i = 0; ok && i < std::ranges::size(container); i++)
+                    ok = add(JS_NewAtomUInt32(ctx, i), true);
+                ok = ok && add(JS_DupAtom(ctx, ctx.rt.Key<"length">(ctx).atom), false);
+            } else {
+                for (auto &[key, elem] : container) {
+                    std::string_view name = key;
+                    if (!(ok = add(JS_NewAtomLen(ctx, name.data(), name.size()), true)))
+                        break;
+                }
+            }
+
+            if (!ok) {
+                for (uint32_t i = 0; i < len; i++)
+                    JS_FreeAtom(ctx, tab[i].atom);
+                js_free(ctx, tab);
+                return -1;
+            }
+
+            *ptab = tab;
+            *plen = len;
+            return 0;
+        }
+
+        static int DeleteProperty(JSContext *__ctx, JSValue obj, JSAtom prop) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx) {
+                JS_ThrowPlainError(__ctx, "Whar");
+                return -1;
+            }
+            auto &ctx = *_ctx;
+            auto &container = *Wrapper::Get(ValueRef(ctx, obj))->owner;
+
+            if (!IsLength(ctx, prop)) {
+                auto found = Find(ctx, container, prop);
+                if (!found.IsOk())
+                    return -1;
+                if (!found.GetOk())
+                    return 1;
+            }
+
+            if constexpr (TWritable && !IsArray) {
+                auto name = Name(ctx, prop);
+                if (!name.IsOk())
+                    return -1;
+                container.erase(typename TContainer::key_type(std::string_view(*name.GetOk())));
+                return 1;
+            }
+
+            return 0;
+        }
+
+        static int DefineOwnProperty(JSContext *__ctx, JSValue obj, JSAtom prop, JSValue val, [[maybe_unused]] JSValue getter, [[maybe_unused]] JSValue setter, int flags) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx) {
+                JS_ThrowPlainError(__ctx, "Whar");
+                return -1;
+            }
+            auto &ctx = *_ctx;
+            auto &container = *Wrapper::Get(ValueRef(ctx, obj))->owner;
+
+            if constexpr (!TWritable) {
+                return Reject(ctx, flags, "Container view is read-only");
+            } else {
+                if (flags & (JS_PROP_HAS_GET | JS_PROP_HAS_SET))
+                    return Reject(ctx, flags, "Container views can't have accessors");
+                if (IsLength(ctx, prop))
+                    return Reject(ctx, flags, "Container views can't be resized");
+
+                auto found = Find(ctx, container, prop);
+                if (!found.IsOk())
+                    return -1;
+
+                Element *elem = found.GetOk();
+                if (IsArray && !elem)
+                    return Reject(ctx, flags, "Index is out of range of the container view");
+
+                // Only changing attributes leaves the element alone.
+                if (!(flags & JS_PROP_HAS_VALUE))
+                    return 1;
+
+                auto res = ValueRef(ctx, val).As<Element>();
+                if (!res.IsOk())
+                    return -1;
+
+                if constexpr (IsArray) {
+                    *elem = std::move(res).GetOk();
+                } else if (elem) {
+                    *elem = std::move(res).GetOk();
+                } else {
+                    auto name = Name(ctx, prop);
+                    if (!name.IsOk())
+                        return -1;
+                    if (!name.GetOk())
+                        return Reject(ctx, flags, "Container view keys must be strings");
+                    container.insert_or_assign(typename TContainer::key_type(std::string_view(*name.GetOk())), std::move(res).GetOk());
+                }
+                return 1;
+            }
+        }
+
+        inline static JSClassExoticMethods exotic {
+            .get_own_property = GetOwnProperty,
+            .get_own_property_names = GetOwnPropertyNames,
+            .delete_property = DeleteProperty,
+            .define_own_property = DefineOwnProperty,
+            .has_property = nullptr,
+            .get_property = nullptr,
+            .set_property = nullptr,
+        };
+
+        public:
+        static Value Wrap(Context &ctx, View view) {
+            Wrapper::RegisterClass(ctx, IsArray ? "ArrayView" : "MapView", nullptr, &exotic);
+
+            // Array views get `Array.prototype`, so `map`, `slice`, iteration and so on work on them. It's read off
+            // a fresh array rather than the global `Array`, which scripts can replace.
+            if (IsArray && JS_IsUndefined(ctx.arrayProto)) {
+                JSValue arr = JS_NewArray(ctx);
+                if (JS_IsException(arr))
+                    return Value::CreateFree(ctx, arr);
+                ctx.arrayProto = JS_GetPrototype(ctx, arr);
+                JS_FreeValue(ctx, arr);
+                if (JS_IsException(ctx.arrayProto)) {
+                    ctx.arrayProto = JS_UNDEFINED;
+                    return Value::CreateFree(ctx, JS_EXCEPTION);
+                }
+            }
+
+            Value obj = Value::CreateFree(ctx, JS_NewObjectProtoClass(ctx, IsArray ? ctx.arrayProto : JS_NULL, Wrapper::GetClassId(ctx.rt)));
+            if (obj.IsException())
+                return obj;
+
+            JS_SetOpaque(obj, new View(std::move(view)));
+            return obj;
+        }
+
+        static JsResult<View> Unwrap(ValueRef value) {
+            if (!Wrapper::IsThis(value))
+                return Value::ThrowTypeError(value.ctx, std::format("Expected {}", NameOf<TContainer>()));
+            return *Wrapper::Get(value);
+        }
+    };
+}
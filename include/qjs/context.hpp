@@ -1,7 +1,10 @@
 #pragma once
 
+#include "qjs/bundle.hpp"
+#include "qjs/source.hpp"
 #include "qjs/value_fwd.hpp"
 #include "quickjs.h"
+#include <optional>
 #include <string>
 #include "module.hpp"
 
@@ -15,11 +18,14 @@ namespace Qjs {
         modules.clear();
         modulesByName.clear();
         modulesByPtr.clear();
+        JS_FreeValue(ctx, arrayProto);
         JS_FreeContext(ctx);
+        bundledModules.clear();
+        bundles.clear();
     }
 
-    inline Value Context::Eval(std::string src, std::string file, int flags) {
-        return Value::CreateFree(*this, JS_Eval(ctx, src.c_str(), src.size(), file.c_str(), flags | JS_EVAL_TYPE_MODULE));
+    inline Value Context::Eval(Source const &src, std::string const &file, int flags) {
+        return Value::CreateFree(*this, JS_Eval(ctx, src.Data(), src.Size(), file.c_str(), flags | JS_EVAL_TYPE_MODULE));
     }
 
     inline Module &Context::AddModule(std::string &&name) {
@@ -34,4 +40,30 @@ namespace Qjs {
 
         return mod;
     }
+
+    inline void Context::AddBundle(Bundle const &bundle) {
+        bundles.push_back(bundle);
+
+        for (auto &mod : bundle.Modules())
+            bundledModules.insert_or_assign(std::string(mod.name), mod.bytecode);
+    }
+
+    inline std::optional<Value> Context::LoadBundled(std::string const &name) {
+        auto it = bundledModules.find(name);
+        if (it == bundledModules.end())
+            return std::nullopt;
+
+        auto &bytecode = it->second;
+        Value mod = Value::CreateFree(*this, JS_ReadObject(ctx, bytecode.data(), bytecode.size(), JS_READ_OBJ_BYTECODE));
+
+        if (mod.IsException()) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+            return std::nullopt;
+        }
+
+        if (mod.value.tag != JS_TAG_MODULE)
+            return std::nullopt;
+
+        return mod;
+    }
 }
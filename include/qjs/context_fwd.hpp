@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "quickjs.h"
@@ -9,6 +13,8 @@
 
 namespace Qjs {
     struct Module;
+    struct Bundle;
+    struct Source;
 
     struct Context final {
         Runtime &rt;
@@ -18,6 +24,15 @@ namespace Qjs {
         std::unordered_map<size_t, size_t> modulesByPtr;
         std::unordered_map<std::string, size_t> modulesByName;
 
+        std::vector<Bundle> bundles;
+        std::unordered_map<std::string, std::span<uint8_t const>> bundledModules;
+
+        /// Classes whose prototype was set in this context through `ClassWrapper::SetProto`.
+        std::unordered_set<JSClassID> classProtos;
+
+        /// The intrinsic `Array.prototype`, taken once by the first array `ContainerView`. Owned by the context.
+        JSValue arrayProto = JS_UNDEFINED;
+
         Context(Runtime &rt);
 
         Context(Context &copy) = delete;
@@ -36,8 +51,16 @@ namespace Qjs {
             return static_cast<Context *>(JS_GetContextOpaque(ctx));
         }
 
-        struct Value Eval(std::string src, std::string file, int flags = 0);
+        /// Evaluates `src` as a module. The source isn't copied.
+        struct Value Eval(Source const &src, std::string const &file, int flags = 0);
 
         Module &AddModule(std::string &&name);
+
+        /// Lets the module loader resolve every module in `bundle` from its bytecode.
+        /// Bundled modules take priority over the runtime's loader function.
+        void AddBundle(Bundle const &bundle);
+
+        /// Instantiates a module from a registered bundle, if there's a usable one by that name.
+        std::optional<struct Value> LoadBundled(std::string const &name);
     };
 }
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "qjs/context_fwd.hpp"
+#include "qjs/runtime_fwd.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Qjs {
+    /// Hands out contexts that already went through a setup function (classes, modules, globals),
+    /// and puts them back in a clean state when they're returned.
+    ///
+    /// Resetting is shallow: properties added to the global object are deleted, and properties
+    /// that existed after setup are pointed back at their original values. Changes made inside
+    /// those values (e.g. monkeypatching `Array.prototype`) aren't undone. A context whose global
+    /// object can't be restored that way (e.g. after a global script declared a `var`) is destroyed
+    /// instead of going back to the pool.
+    ///
+    /// Like the runtime it's built on, it isn't thread safe. It must be destroyed before the runtime.
+    struct ContextPool final {
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t resets = 0;
+            /// Returned contexts that couldn't be reset, and were destroyed instead.
+            size_t discarded = 0;
+            std::chrono::nanoseconds resetTime {0};
+        };
+
+        using Setup = std::function<void (Context &)>;
+
+        private:
+        struct Entry final {
+            struct Property {
+                JSAtom atom;
+                Value value;
+            };
+
+            std::unique_ptr<Context> ctx;
+            std::vector<Property> baseline {};
+
+            Entry(Runtime &rt) : ctx(std::make_unique<Context>(rt)) {}
+
+            Entry(Entry const &copy) = delete;
+
+            ~Entry() {
+                for (auto &prop : baseline)
+                    JS_FreeAtom(*ctx, prop.atom);
+                baseline.clear();
+            }
+
+            void Snapshot() {
+                Value global = Value::Global(*ctx);
+
+                JSPropertyEnum *props;
+                uint32_t len;
+                if (JS_GetOwnPropertyNames(*ctx, &props, &len, global, JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK) < 0) {
+                    JS_FreeValue(*ctx, JS_GetException(*ctx));
+                    return;
+                }
+
+                baseline.reserve(len);
+                for (uint32_t i = 0; i < len; i++)
+                    baseline.push_back({JS_DupAtom(*ctx, props[i].atom), Value::CreateFree(*ctx, JS_GetProperty(*ctx, global, props[i].atom))});
+
+                JS_FreePropertyEnum(*ctx, props, len);
+
+                std::sort(baseline.begin(), baseline.end(), [](Property const &a, Property const &b) { return a.atom < b.atom; });
+            }
+
+            bool InBaseline(JSAtom atom) const {
+                auto it = std::lower_bound(baseline.begin(), baseline.end(), atom, [](Property const &prop, JSAtom atom) { return prop.atom < atom; });
+                return it != baseline.end() && it->atom == atom;
+            }
+
+            static bool Same(JSValue a, JSValue b) {
+                if (a.tag != b.tag)
+                    return false;
+                if (JS_VALUE_HAS_REF_COUNT(a))
+                    return JS_VALUE_GET_PTR(a) == JS_VALUE_GET_PTR(b);
+                if (a.tag == JS_TAG_FLOAT64)
+                    return std::memcmp(&a.u.float64, &b.u.float64, sizeof(double)) == 0;
+                return a.u.int32 == b.u.int32;
+            }
+
+            /// Returns false if the context can't be put back in its baseline state, and has to be thrown away.
+            /// Pending jobs are only run when `drain` is set: the job queue belongs to the runtime, so it can hold
+            /// jobs of contexts that are still checked out.
+            bool Reset(bool drain) {
+                Context &ctx = *this->ctx;
+
+                if (JS_IsJobPending(ctx.rt)) {
+                    if (!drain)
+                        return false;
+
+                    JSContext *jobCtx;
+                    int res;
+                    while ((res = JS_ExecutePendingJob(ctx.rt, &jobCtx)) != 0) {
+                        // Another context's error is left for its owner to pick up.
+                        if (res < 0 && jobCtx != ctx)
+                            return false;
+                        if (res < 0)
+                            JS_FreeValue(jobCtx, JS_GetException(jobCtx));
+                    }
+                }
+
+                JS_FreeValue(ctx, JS_GetException(ctx));
+
+                Value global = Value::Global(ctx);
+
+                JSPropertyEnum *props;
+                uint32_t len;
+                if (JS_GetOwnPropertyNames(ctx, &props, &len, global, JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK) < 0) {
+                    JS_FreeValue(ctx, JS_GetException(ctx));
+                    return false;
+                }
+
+                bool clean = true;
+                for (uint32_t i = 0; i < len; i++) {
+                    // `var` and function declarations of global scripts aren't configurable, so they can't be deleted.
+                    if (!InBaseline(props[i].atom) && JS_DeleteProperty(ctx, global, props[i].atom, 0) <= 0)
+                        clean = false;
+                }
+                JS_FreePropertyEnum(ctx, props, len);
+
+                if (!clean) {
+                    JS_FreeValue(ctx, JS_GetException(ctx));
+                    return false;
+                }
+
+                for (auto &prop : baseline) {
+                    Value current = Value::CreateFree(ctx, JS_GetProperty(ctx, global, prop.atom));
+                    if (Same(current, prop.value))
+                        continue;
+
+                    if (JS_SetProperty(ctx, global, prop.atom, prop.value.ToUnmanaged()) <= 0) {
+                        JS_FreeValue(ctx, JS_GetException(ctx));
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+        };
+
+        Runtime &rt;
+        size_t const Capacity;
+        Setup const setup;
+        std::vector<std::unique_ptr<Entry>> idle {};
+        size_t leased = 0;
+        Stats stats {};
+
+        std::unique_ptr<Entry> Create() {
+            auto entry = std::make_unique<Entry>(rt);
+            setup(*entry->ctx);
+            entry->Snapshot();
+            return entry;
+        }
+
+        public:
+        /// A checked out context. It goes back to the pool when this is destroyed.
+        struct Lease final {
+            private:
+            ContextPool *pool;
+            std::unique_ptr<Entry> entry;
+
+            Lease(ContextPool &pool, std::unique_ptr<Entry> &&entry) : pool(&pool), entry(std::move(entry)) {}
+            friend struct ContextPool;
+
+            public:
+            Lease(Lease const &copy) = delete;
+
+            Lease(Lease &&move) : pool(move.pool), entry(std::move(move.entry)) {}
+
+            ~Lease() {
+                if (entry)
+                    pool->Release(std::move(entry));
+            }
+
+            Context &operator * () {
+                return *entry->ctx;
+            }
+
+            Context *operator -> () {
+                return entry->ctx.get();
+            }
+
+            operator Context & () {
+                return *entry->ctx;
+            }
+        };
+
+        ContextPool(Runtime &rt, size_t capacity, Setup &&setup) : rt(rt), Capacity(capacity), setup(std::move(setup)) {
+            idle.reserve(Capacity);
+            for (size_t i = 0; i < Capacity; i++)
+                idle.push_back(Create());
+        }
+
+        ContextPool(ContextPool const &copy) = delete;
+
+        ~ContextPool() {
+            idle.clear();
+        }
+
+        Lease Acquire() {
+            leased++;
+
+            if (idle.empty()) {
+                stats.misses++;
+                return Lease(*this, Create());
+            }
+
+            stats.hits++;
+            auto entry = std::move(idle.back());
+            idle.pop_back();
+            return Lease(*this, std::move(entry));
+        }
+
+        Stats const &GetStats() const {
+            return stats;
+        }
+
+        size_t Idle() const {
+            return idle.size();
+        }
+
+        private:
+        void Release(std::unique_ptr<Entry> &&entry) {
+            leased--;
+
+            if (idle.size() >= Capacity)
+                return;
+
+            auto start = std::chrono::steady_clock::now();
+            bool reset = entry->Reset(leased == 0);
+            stats.resetTime += std::chrono::steady_clock::now() - start;
+            stats.resets++;
+
+            if (!reset) {
+                stats.discarded++;
+                return;
+            }
+
+            idle.push_back(std::move(entry));
+        }
+    };
+}
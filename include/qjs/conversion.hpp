@@ -6,18 +6,23 @@
 #include "qjs/functionwrapper_fwd.hpp"
 #include "qjs/object.hpp"
 #include "qjs/result_fwd.hpp"
+#include "qjs/stringview.hpp"
 #include "qjs/util.hpp"
 #include "quickjs.h"
 #include "value_fwd.hpp"
 #include "qjs/class.hpp"
 
 #include "conversion_fwd.hpp"
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <expected>
 #include <format>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -91,7 +96,7 @@ namespace Qjs {
             return Value::CreateFree(ctx, JS_NewInt64(ctx, value));
         }
 
-        static JsResult<TInt> Unwrap(Value const &value) {
+        static JsResult<TInt> Unwrap(ValueRef value) {
             if (!ValidValue(value))
                 return Value::ThrowTypeError(value.ctx, "Expected number");
 
@@ -101,7 +106,7 @@ namespace Qjs {
             return TInt(value.value.u.float64);
         }
 
-        static bool ValidValue(Value const &value) {
+        static bool ValidValue(ValueRef value) {
             return JS_IsNumber(value);
         }
     };
@@ -112,10 +117,10 @@ namespace Qjs {
         static constexpr bool Implemented = true;
 
         static Value Wrap(Context &ctx, TFloat value) {
-            return Value::CreateFree(ctx, JS_NewFloat64(ctx, int64_t(value)));
+            return Value::CreateFree(ctx, JS_NewFloat64(ctx, value));
         }
 
-        static JsResult<TFloat> Unwrap(Value const &value) {
+        static JsResult<TFloat> Unwrap(ValueRef value) {
             if (!ValidValue(value))
                 return Value::ThrowTypeError(value.ctx, "Expected number");
 
@@ -125,7 +130,7 @@ namespace Qjs {
             return TFloat(value.value.u.float64);
         }
 
-        static bool ValidValue(Value const &value) {
+        static bool ValidValue(ValueRef value) {
             return JS_IsNumber(value);
         }
     };
@@ -142,15 +147,14 @@ namespace Qjs {
             return Conversion<T>::Wrap(ctx, *value);
         }
 
-        static JsResult<std::optional<T>> Unwrap(Value value) {
-            auto tag = value.value.tag;
+        static JsResult<std::optional<T>> Unwrap(ValueRef value) {
             if (value.IsNullish())
                 return std::optional<T>(std::nullopt);
 
             auto val = Conversion<T>::Unwrap(value);
 
             if (!val.IsOk())
-                return val.GetErr();
+                return std::move(val).GetErr();
 
             return std::optional<T>(val.GetOk());
         }
@@ -164,7 +168,7 @@ namespace Qjs {
             return Value::CreateFree(ctx, JS_NewBool(ctx, value));
         }
 
-        static JsResult<bool> Unwrap(Value const &value) {
+        static JsResult<bool> Unwrap(ValueRef value) {
             return JS_ToBool(value.ctx, value);
         }
     };
@@ -174,14 +178,14 @@ namespace Qjs {
         static constexpr bool Implemented = true;
 
         static Value Wrap(Context &ctx, Object value) {
-            return value;
+            return std::move(value.value);
         }
 
-        static JsResult<Object> Unwrap(Value const &value) {
+        static JsResult<Object> Unwrap(ValueRef value) {
             if (!JS_IsObject(value))
                 return Value::ThrowTypeError(value.ctx, "Expected object");
 
-            return Object(value);
+            return Object(value.ToValue());
         }
     };
 
@@ -193,11 +197,121 @@ namespace Qjs {
             return Value::CreateFree(ctx, JS_NewStringLen(ctx, value.c_str(), value.size()));
         }
 
-        static JsResult<std::string> Unwrap(Value const &value) {
+        static JsResult<std::string> Unwrap(ValueRef value) {
             return value.ToString();
         }
     };
 
+    /// Only wraps, since a view has nothing to point into once the native call returns. Take a `JsStringView` instead.
+    template <>
+    struct Conversion<std::string_view> final {
+        static constexpr bool Implemented = true;
+
+        static Value Wrap(Context &ctx, std::string_view value) {
+            return Value::CreateFree(ctx, JS_NewStringLen(ctx, value.data(), value.size()));
+        }
+    };
+
+    /// For string literals, which decay to this in `Value::From`. Only wraps, like `std::string_view`.
+    template <>
+    struct Conversion<char const *> final {
+        static constexpr bool Implemented = true;
+
+        static Value Wrap(Context &ctx, char const *value) {
+            return Value::CreateFree(ctx, JS_NewString(ctx, value));
+        }
+    };
+
+    template <>
+    struct Conversion<JsStringView> final {
+        static constexpr bool Implemented = true;
+
+        static Value Wrap(Context &ctx, JsStringView const &value) {
+            return Value::CreateFree(ctx, JS_NewStringLen(ctx, value.Data(), value.Size()));
+        }
+
+        static JsResult<JsStringView> Unwrap(ValueRef value) {
+            size_t size;
+            char const *data = JS_ToCStringLen(value.ctx, &size, value);
+            if (!data)
+                return Value(value.ctx, JS_EXCEPTION);
+
+            return JsStringView(value.ctx, data, size);
+        }
+    };
+
+    /// QuickJS doesn't expose its UTF-16 strings, so this goes through UTF-8 on the C++ side.
+    /// Lone surrogates survive the round trip.
+    template <>
+    struct Conversion<std::u16string> final {
+        static constexpr bool Implemented = true;
+
+        static Value Wrap(Context &ctx, std::u16string_view value) {
+            std::string utf8;
+            utf8.reserve(value.size());
+
+            for (size_t i = 0; i < value.size(); i++) {
+                char32_t c = value[i];
+                if (c >= 0xd800 && c < 0xdc00 && i + 1 < value.size() && value[i + 1] >= 0xdc00 && value[i + 1] < 0xe000)
+                    c = 0x10000 + ((c - 0xd800) << 10) + (value[++i] - 0xdc00);
+
+                if (c < 0x80) {
+                    utf8 += char(c);
+                } else if (c < 0x800) {
+                    utf8 += char(0xc0 | (c >> 6));
+                    utf8 += char(0x80 | (c & 0x3f));
+                } else if (c < 0x10000) {
+                    utf8 += char(0xe0 | (c >> 12));
+                    utf8 += char(0x80 | ((c >> 6) & 0x3f));
+                    utf8 += char(0x80 | (c & 0x3f));
+                } else {
+                    utf8 += char(0xf0 | (c >> 18));
+                    utf8 += char(0x80 | ((c >> 12) & 0x3f));
+                    utf8 += char(0x80 | ((c >> 6) & 0x3f));
+                    utf8 += char(0x80 | (c & 0x3f));
+                }
+            }
+
+            return Value::CreateFree(ctx, JS_NewStringLen(ctx, utf8.data(), utf8.size()));
+        }
+
+        static JsResult<std::u16string> Unwrap(ValueRef value) {
+            auto res = Conversion<JsStringView>::Unwrap(value);
+            if (!res.IsOk())
+                return std::move(res).GetErr();
+
+            JsStringView utf8 = std::move(res).GetOk();
+            auto bytes = reinterpret_cast<unsigned char const *>(utf8.Data());
+
+            std::u16string out;
+            out.reserve(utf8.Size());
+
+            for (size_t i = 0; i < utf8.Size();) {
+                char32_t c = bytes[i];
+                size_t len = c < 0x80 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+                if (i + len > utf8.Size())
+                    break;
+
+                if (len == 2)
+                    c = ((c & 0x1f) << 6) | (bytes[i + 1] & 0x3f);
+                else if (len == 3)
+                    c = ((c & 0x0f) << 12) | ((bytes[i + 1] & 0x3f) << 6) | (bytes[i + 2] & 0x3f);
+                else if (len == 4)
+                    c = ((c & 0x07) << 18) | ((bytes[i + 1] & 0x3f) << 12) | ((bytes[i + 2] & 0x3f) << 6) | (bytes[i + 3] & 0x3f);
+                i += len;
+
+                if (c >= 0x10000) {
+                    out += char16_t(0xd800 + ((c - 0x10000) >> 10));
+                    out += char16_t(0xdc00 + ((c - 0x10000) & 0x3ff));
+                } else {
+                    out += char16_t(c);
+                }
+            }
+
+            return out;
+        }
+    };
+
     template <typename TReturn, typename ...TArgs>
         requires (Conversion<TReturn>::Implemented || std::is_same_v<TReturn, void>)
     struct Conversion<std::function<TReturn(TArgs...)>> final {
@@ -213,40 +327,42 @@ namespace Qjs {
                 return JS_ThrowPlainError(__ctx, "Whar");
 
             auto &ctx = *_ctx;
-            Value funcObj {ctx, func_obj};
+            Conversion *conv = Wrapper::Get(ValueRef(ctx, func_obj));
 
-            Conversion *conv = Wrapper::Get(funcObj);
+            ValueRef thisVal {ctx, this_val};
 
-            Value thisVal = Value(ctx, this_val);
+            auto optArgs = UnpackWrapper<std::decay_t<TArgs>...>::UnpackArgs(ctx, thisVal, argc, argv);
+            if (!optArgs.IsOk())
+                return std::move(optArgs).GetErr().ToUnmanaged();
 
-            auto args = UnpackWrapper<std::decay_t<TArgs>...>::UnpackArgs(ctx, thisVal, argc, argv);
-            if (!args.IsOk())
-                return args.GetErr().ToUnmanaged();
+            auto args = std::move(optArgs).GetOk();
+            auto call = [conv](auto &...args) -> decltype(auto) {
+                return conv->fun(PassArg<TArgs>(args)...);
+            };
             
             if constexpr (std::is_same_v<TReturn, void>) {
-                std::apply(std::forward<TFun>(conv->fun), args.GetOk());
+                std::apply(call, args);
                 return JS_UNDEFINED;
             } else {
-                return Value::From(ctx, std::apply(std::forward<TFun>(conv->fun), args.GetOk())).ToUnmanaged();
+                return Value::From(ctx, std::apply(call, args)).ToUnmanaged();
             }
         }
 
         static Value Wrap(Context &ctx, TFun f) {
             Wrapper::RegisterClass(ctx, "Function", Invoke);
 
-            return Wrapper::New(ctx, new Conversion {f});
+            return Wrapper::New(ctx, new Conversion {std::move(f)});
         }
 
-        static JsResult<TFun> Unwrap(Value const &value) {
+        static JsResult<TFun> Unwrap(ValueRef value) {
             Wrapper::RegisterClass(value.ctx, "Function", Invoke);
 
             if (JS_GetClassID(value) == Wrapper::GetClassId(value.ctx.rt))
                 return Wrapper::Get(value)->fun;
 
-            return (TFun) [&](TArgs ...args) -> TReturn {
-                if constexpr (std::is_same_v<TReturn, void>)
-                    value.Invoke<TReturn, TArgs...>(args...);
-                else value.Invoke<TReturn, TArgs...>(args...).GetOk();
+            // The argument is only borrowed, so the closure keeps its own reference.
+            return (TFun) [fn = value.ToValue()](TArgs ...args) mutable -> TReturn {
+                return fn.Invoke<TReturn>(std::move(args)...).GetOk();
             };
         }
     };
@@ -258,13 +374,13 @@ namespace Qjs {
         using Func = Function<TReturn, TArgs...>;
 
         static Value Wrap(Context &ctx, Func f) {
-            return f.value;
+            return std::move(f.value);
         }
 
-        static JsResult<Func> Unwrap(Value &value) {
+        static JsResult<Func> Unwrap(ValueRef value) {
             if (!JS_IsFunction(value.ctx, value))
                 return Value::ThrowTypeError(value.ctx, "Expected function.");
-            return Func {value};
+            return Func {value.ToValue()};
         }
     };
 
@@ -274,14 +390,17 @@ namespace Qjs {
         static constexpr bool Implemented = true;
         using Wrapper = ClassWrapper<T>;
 
+        /// The wrapper takes ownership, which pooled classes don't allow: their instances come from the pool.
         static Value Wrap(Context &ctx, T *cl) {
+            static_assert(!ClassAllocTraits<T>::Pooled, "Pointers to pooled classes can't be handed to JS; return the class by value.");
+
             if (cl == nullptr)
                 return Value::Null(ctx);
 
             return Wrapper::New(ctx, cl);
         }
 
-        static JsResult<T *> Unwrap(Value const &value) {
+        static JsResult<T *> Unwrap(ValueRef value) {
             if (value.IsNullish())
                 return nullptr;
 
@@ -306,7 +425,7 @@ namespace Qjs {
             return Wrapper::New(ctx, cl);
         }
 
-        static JsResult<T *> Unwrap(Value const &value) {
+        static JsResult<T *> Unwrap(ValueRef value) {
             if (value.IsNullish())
                 return nullptr;
 
@@ -325,10 +444,12 @@ namespace Qjs {
         using Wrapper = Conversion<T *>::Wrapper;
 
         static Value Wrap(Context &ctx, RequireNonNull<T> cl) {
+            static_assert(!ClassAllocTraits<T>::Pooled, "Pointers to pooled classes can't be handed to JS; return the class by value.");
+
             return Wrapper::New(ctx, cl);
         }
 
-        static JsResult<RequireNonNull<T>> Unwrap(Value const &value) {
+        static JsResult<RequireNonNull<T>> Unwrap(ValueRef value) {
             if (!Wrapper::IsThis(value))
                 return Value::ThrowTypeError(value.ctx, std::format("Expected {}", NameOf<T>()));
 
@@ -346,11 +467,11 @@ namespace Qjs {
             return value.jsThis;
         }
 
-        static JsResult<PassJsThis<T>> Unwrap(Value value) {
+        static JsResult<PassJsThis<T>> Unwrap(ValueRef value) {
             JsResult<T> result = Conversion<T>::Unwrap(value);
             if (!result.IsOk())
-                return result.GetErr();
-            return PassJsThis<T> {value, result.GetOk()};
+                return std::move(result).GetErr();
+            return PassJsThis<T> {value.ToValue(), std::move(result).GetOk()};
         }
     };
     
@@ -362,14 +483,59 @@ namespace Qjs {
         using Wrapper = Conversion<T *>::Wrapper;
 
         static Value Wrap(Context &ctx, T const &cl) {
-            return Conversion<RequireNonNull<T>>::Wrap(ctx, RequireNonNull<T>(new T(cl)));
+            return ClassWrapper<T>::Make(ctx, cl);
         }
 
-        static JsResult<T> Unwrap(Value const &value) {
+        static JsResult<T> Unwrap(ValueRef value) {
             auto res = Conversion<RequireNonNull<T>>::Unwrap(value);
             if (!res.IsOk())
-                return res.GetErr();
-            return *res.GetOk();
+                return std::move(res).GetErr();
+            return *std::move(res).GetOk();
+        }
+    };
+
+    /// Shared by the conversions of array-like containers.
+    struct ArrayConversion final {
+        /// Fills a new array in index order. Defining the elements (rather than setting them) appends them
+        /// directly, so the array stays dense and no setters or prototypes are looked at.
+        template <typename TRange>
+        static Value Wrap(Context &ctx, TRange &&range) {
+            Value arr = Value::Array(ctx);
+            if (arr.IsException())
+                return arr;
+
+            uint32_t i = 0;
+            for (auto &&item : range) {
+                JSValue val;
+                if constexpr (std::is_lvalue_reference_v<TRange>)
+                    val = Value::From(ctx, item).ToUnmanaged();
+                else
+                    val = Value::From(ctx, std::move(item)).ToUnmanaged();
+
+                if (JS_DefinePropertyValueUint32(ctx, arr, i++, val, JS_PROP_C_W_E) < 0)
+                    return Value(ctx, JS_EXCEPTION);
+            }
+
+            return arr;
+        }
+
+        /// Works for anything with a `length`, not just arrays.
+        static JsResult<uint64_t> Length(ValueRef value) {
+            if (!JS_IsObject(value))
+                return Value::ThrowTypeError(value.ctx, "Expected array");
+
+            int64_t len;
+            if (JS_GetLength(value.ctx, value, &len) < 0)
+                return Value(value.ctx, JS_EXCEPTION);
+
+            return uint64_t(len);
+        }
+
+        /// Goes through the engine's indexed access, which reads dense arrays directly and does a full lookup
+        /// for holes, proxies and array-likes.
+        template <typename T>
+        static JsResult<T> Element(ValueRef arr, uint64_t index) {
+            return Value::CreateFree(arr.ctx, JS_GetPropertyInt64(arr.ctx, arr, index)).template As<T>();
         }
     };
 
@@ -378,27 +544,37 @@ namespace Qjs {
     struct Conversion<std::vector<T>> final {
         static constexpr bool Implemented = true;
 
+        /// How many elements `Unwrap` reserves before it has seen them.
+        static constexpr uint64_t MaxReserve = 4096;
+
         static Value Wrap(Context &ctx, std::vector<T> const &vec) {
-            Value arr = Value::Array(ctx);
-            for (size_t i = 0; i < vec.size(); i++)
-                arr[i] = Value::From(ctx, vec[i]);
-            return arr;
+            return ArrayConversion::Wrap(ctx, vec);
         }
 
-        static JsResult<std::vector<T>> Unwrap(Value &value) {
-            auto lenRes = (*value["length"]).As<size_t>();
+        static Value Wrap(Context &ctx, std::vector<T> &&vec) {
+            return ArrayConversion::Wrap(ctx, std::move(vec));
+        }
+
+        static JsResult<std::vector<T>> Unwrap(ValueRef value) {
+            auto lenRes = ArrayConversion::Length(value);
             if (!lenRes.IsOk())
-                return lenRes.GetErr();
+                return std::move(lenRes).GetErr();
 
-            size_t len = lenRes.GetOk();
+            uint64_t len = std::move(lenRes).GetOk();
 
             std::vector<T> out {};
 
-            for (size_t i = 0; i < len; i++) {
-                auto res = (*value[i]).As<T>();
+            // Any array can claim a length it doesn't have (holes, proxies), so only a bounded amount is reserved
+            // up front. Throwing a C++ exception out of here would go through the engine's frames.
+            if (len > out.max_size())
+                return Value::ThrowRangeError(value.ctx, "Array is too long");
+            out.reserve(std::min<uint64_t>(len, MaxReserve));
+
+            for (uint64_t i = 0; i < len; i++) {
+                auto res = ArrayConversion::Element<T>(value, i);
                 if (!res.IsOk())
-                    return res.GetErr();
-                out.push_back(res.GetOk());
+                    return std::move(res).GetErr();
+                out.push_back(std::move(res).GetOk());
             }
 
             return out;
@@ -411,33 +587,34 @@ namespace Qjs {
         static constexpr bool Implemented = true;
 
         static Value Wrap(Context &ctx, std::array<T, TLen> const &vec) {
-            Value arr = Value::Array(ctx);
-            for (size_t i = 0; i < vec.size(); i++)
-                arr[i] = Value::From(ctx, vec[i]);
-            return arr;
+            return ArrayConversion::Wrap(ctx, vec);
+        }
+
+        static Value Wrap(Context &ctx, std::array<T, TLen> &&vec) {
+            return ArrayConversion::Wrap(ctx, std::move(vec));
         }
 
-        static JsResult<std::array<T, TLen>> Unwrap(Value &value) {
-            auto lenRes = (*value["length"]).As<size_t>();
+        static JsResult<std::array<T, TLen>> Unwrap(ValueRef value) {
+            auto lenRes = ArrayConversion::Length(value);
             if (!lenRes.IsOk())
-                return lenRes.GetErr();
+                return std::move(lenRes).GetErr();
 
-            size_t len = lenRes.GetOk();
+            size_t len = std::min<uint64_t>(std::move(lenRes).GetOk(), TLen);
 
             std::array<T, TLen> out {};
 
             for (size_t i = 0; i < len; i++) {
-                auto res = (*value[i]).As<T>();
+                auto res = ArrayConversion::Element<T>(value, i);
                 if (!res.IsOk())
-                    return res.GetErr();
-                out[i] = res.GetOk();
+                    return std::move(res).GetErr();
+                out[i] = std::move(res).GetOk();
             }
 
             for (size_t i = len; i < TLen; i++) {
                 auto res = Value::Undefined(value.ctx).As<T>();
                 if (!res.IsOk())
-                    return res.GetErr();
-                out[i] = res.GetOk();
+                    return std::move(res).GetErr();
+                out[i] = std::move(res).GetOk();
             }
             
             return out;
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "qjs/classbuilder_fwd.hpp"
+#include "qjs/functionwrapper_fwd.hpp"
+#include "qjs/sharedtrampolines.hpp"
+#include "qjs/util.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace Qjs {
+    /// A function property, like `ClassBuilder::Method`.
+    template <FixedString TName, auto TFun>
+    struct MethodEntry final {
+        static constexpr JSCFunctionListEntry Entry = JS_CFUNC_DEF(TName.CStr(), FunctionWrapper<TFun>::ArgCount, FunctionWrapper<TFun>::Invoke);
+
+        static JSCFunctionListEntry SharedEntry() {
+            return JSCFunctionListEntry JS_CFUNC_MAGIC_DEF(TName.CStr(), FunctionWrapper<TFun>::ArgCount, SharedTrampolines::Call, int16_t(SharedTrampolines::CallIndex<TFun>()));
+        }
+    };
+
+    /// An accessor for a data member, like `ClassBuilder::Field`. Const members only get a getter.
+    template <FixedString TName, auto TField>
+    struct FieldEntry final {
+        private:
+        template <auto TMember>
+        struct Traits;
+
+        template <typename TClass, typename TValue, TValue (TClass::*TMember)>
+        struct Traits<TMember> {
+            static constexpr bool IsConst = std::is_const_v<TValue>;
+        };
+
+        static JSValue Get(JSContext *ctx, JSValue this_val) {
+            return GetSetWrapper<TField>::Get(ctx, this_val, 0, nullptr);
+        }
+
+        static JSValue Set(JSContext *ctx, JSValue this_val, JSValue val) {
+            return GetSetWrapper<TField>::Set(ctx, this_val, 1, &val);
+        }
+
+        static constexpr auto Setter() {
+            if constexpr (Traits<TField>::IsConst)
+                return (JSValue (*)(JSContext *, JSValue, JSValue)) nullptr;
+            else
+                return &Set;
+        }
+
+        public:
+        static constexpr JSCFunctionListEntry Entry = JS_CGETSET_DEF(TName.CStr(), Get, Setter());
+
+        static JSCFunctionListEntry SharedEntry() {
+            auto set = Traits<TField>::IsConst ? nullptr : SharedTrampolines::Set;
+            return JSCFunctionListEntry JS_CGETSET_MAGIC_DEF(TName.CStr(), SharedTrampolines::Get, set, int16_t(SharedTrampolines::AccessorIndex<TField>()));
+        }
+    };
+
+    /// A read-only number. Integers that don't fit in an `int64_t` are stored as doubles. There's no list entry for
+    /// booleans, so `bool` isn't accepted.
+    template <FixedString TName, auto TValue>
+        requires (std::integral<decltype(TValue)> && !std::same_as<decltype(TValue), bool>) || std::floating_point<decltype(TValue)>
+    struct ConstantEntry final {
+        static constexpr JSCFunctionListEntry Entry = [] {
+            using T = decltype(TValue);
+            if constexpr (std::floating_point<T>)
+                return JSCFunctionListEntry JS_PROP_DOUBLE_DEF(TName.CStr(), double(TValue), JS_PROP_CONFIGURABLE);
+            else if constexpr (std::in_range<int32_t>(std::numeric_limits<T>::min()) && std::in_range<int32_t>(std::numeric_limits<T>::max()))
+                return JSCFunctionListEntry JS_PROP_INT32_DEF(TName.CStr(), int32_t(TValue), JS_PROP_CONFIGURABLE);
+            else if constexpr (std::in_range<int64_t>(TValue))
+                return JSCFunctionListEntry JS_PROP_INT64_DEF(TName.CStr(), int64_t(TValue), JS_PROP_CONFIGURABLE);
+            else
+                return JSCFunctionListEntry JS_PROP_DOUBLE_DEF(TName.CStr(), double(TValue), JS_PROP_CONFIGURABLE);
+        }();
+
+        static JSCFunctionListEntry SharedEntry() {
+            return Entry;
+        }
+    };
+
+    /// A read-only string.
+    template <FixedString TName, FixedString TValue>
+    struct StringConstantEntry final {
+        static constexpr JSCFunctionListEntry Entry = JS_PROP_STRING_DEF(TName.CStr(), TValue.CStr(), JS_PROP_CONFIGURABLE);
+
+        static JSCFunctionListEntry SharedEntry() {
+            return Entry;
+        }
+    };
+
+    /// A `JSCFunctionListEntry` table built at compile time. There's one table per list, shared by every context
+    /// and runtime, and installing it is a single `JS_SetPropertyFunctionList` call instead of a property set
+    /// (and a separate build step) per member.
+    ///
+    /// The properties are non-enumerable, like those of built-in classes.
+    ///
+    /// With `QJS_CPP_SHARED_TRAMPOLINES`, the table points at the shared trampolines instead. Their magic numbers
+    /// are only known at run time, so that table is built on first use (still once, not per context).
+    template <typename ...TEntries>
+    struct FunctionList final {
+        static constexpr std::array<JSCFunctionListEntry, sizeof...(TEntries)> Entries {TEntries::Entry...};
+
+        static void Install(ValueRef obj) {
+#ifdef QJS_CPP_SHARED_TRAMPOLINES
+            static std::array<JSCFunctionListEntry, sizeof...(TEntries)> const shared {TEntries::SharedEntry()...};
+            JS_SetPropertyFunctionList(obj.ctx, obj, shared.data(), shared.size());
+#else
+            JS_SetPropertyFunctionList(obj.ctx, obj, Entries.data(), Entries.size());
+#endif
+        }
+    };
+}
@@ -11,78 +11,94 @@
 #include <type_traits>
 
 namespace Qjs {
-    template <typename ...TArgs, std::size_t... TIndices>
-        requires (Conversion<TArgs>::Implemented,...)
-    static JsResult<std::tuple<TArgs...>> UnpackArgsImpl(Context &ctx, Value thisVal, int argc, JSValue *argv, std::index_sequence<TIndices...>) {
-        std::array<Value, sizeof...(TArgs)> rawArgs {(Unit<TArgs>(Value::Undefined(ctx)))...};
-        for (size_t i = 0; i < std::min(sizeof...(TArgs), size_t(argc)); i++)
-            rawArgs[i] = Value(ctx, argv[i]);
-        try {
-            std::tuple<TArgs...> args {rawArgs[TIndices].template As<TArgs>().GetOk()...};
-            return args;
-        } catch (Value v) {
-            return v;
+    /// Converts the arguments into a `TResult` tuple one at a time, and returns the error of the first one that fails.
+    /// `done` holds everything converted so far, and is passed on (by reference) until the tuple can be built from it.
+    /// The first `TOffset` elements of the tuple don't come from `argv`.
+    template <typename TResult, size_t TOffset, typename ...TDone>
+    JsResult<TResult> UnpackArgsImpl(Context &ctx, int argc, JSValue *argv, TDone &&...done) {
+        constexpr size_t Index = sizeof...(TDone);
+
+        if constexpr (Index == std::tuple_size_v<TResult>) {
+            return TResult(std::forward<TDone>(done)...);
+        } else {
+            using T = std::tuple_element_t<Index, TResult>;
+            constexpr size_t Arg = Index - TOffset;
+
+            JsResult<T> res = Conversion<T>::Unwrap(ValueRef(ctx, Arg < size_t(argc) ? argv[Arg] : JS_UNDEFINED));
+            if (!res.IsOk())
+                return std::move(res).GetErr();
+
+            return UnpackArgsImpl<TResult, TOffset>(ctx, argc, argv, std::forward<TDone>(done)..., std::move(res).GetOk());
         }
     }
 
     template <typename ...TArgs>
         requires (Conversion<TArgs>::Implemented,...)
     struct UnpackWrapper<TArgs...> {
-        static JsResult<std::tuple<TArgs...>> UnpackArgs(Context &ctx, Value thisVal, int argc, JSValue *argv) {
-            return UnpackArgsImpl<TArgs...>(ctx, thisVal, argc, argv, std::make_index_sequence<sizeof...(TArgs)>());
+        static JsResult<std::tuple<TArgs...>> UnpackArgs(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
+            return UnpackArgsImpl<std::tuple<TArgs...>, 0>(ctx, argc, argv);
         }
     };
 
     template <>
     struct UnpackWrapper<> {
-        static JsResult<std::tuple<>> UnpackArgs(Context &ctx, Value thisVal, int argc, JSValue *argv) {
+        static JsResult<std::tuple<>> UnpackArgs(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
             return std::tuple<>();
         }
     };
 
     template <>
     struct UnpackWrapper<Value> {
-        static JsResult<std::tuple<Value>> UnpackArgs(Context &ctx, Value thisVal, int argc, JSValue *argv) {
-            return std::tuple<Value>(thisVal);
+        static JsResult<std::tuple<Value>> UnpackArgs(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
+            return std::tuple<Value>(thisVal.ToValue());
         }
     };
 
     template <typename ...TArgs>
         requires ((Conversion<TArgs>::Implemented,...))
     struct UnpackWrapper<Value, TArgs...> {
-        static JsResult<std::tuple<Value, TArgs...>> UnpackArgs(Context &ctx, Value thisVal, int argc, JSValue *argv) {
-            auto result = UnpackArgsImpl<TArgs...>(ctx, thisVal, argc, argv, std::make_index_sequence<sizeof...(TArgs)>());
-            if (!result.IsOk())
-                return result.GetErr();
-
-            return std::tuple_cat(std::tuple<Value> {thisVal}, result.GetOk());
+        static JsResult<std::tuple<Value, TArgs...>> UnpackArgs(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
+            return UnpackArgsImpl<std::tuple<Value, TArgs...>, 1>(ctx, argc, argv, thisVal.ToValue());
         }
     };
 
+    /// The entry point of a native function: finds the `Context`, and hands over to `TCall` for the typed part.
+    template <JSValue (*TCall)(Context &, ValueRef, int, JSValue *)>
+    JSValue Dispatch(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv) {
+        auto _ctx = Context::From(__ctx);
+        if (!_ctx)
+            return JS_ThrowPlainError(__ctx, "Whar");
+        auto &ctx = *_ctx;
+
+        return TCall(ctx, ValueRef(ctx, this_val), argc, argv);
+    }
+
     template <typename TReturn, typename ...TArgs, TReturn (*TFun)(TArgs...)>
     struct FunctionWrapper<TFun> {
         static constexpr size_t ArgCount = sizeof...(TArgs);
 
-        static JSValue Invoke(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv) {
-            auto _ctx = Context::From(__ctx);
-            if (!_ctx)
-                return JS_ThrowPlainError(__ctx, "Whar");
-            auto &ctx = *_ctx;
+        static JSValue Invoke(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+            return Dispatch<Call>(ctx, this_val, argc, argv);
+        }
 
-            Value thisVal {ctx, this_val};
-            
+        /// The typed part of `Invoke`, which shared trampolines call directly.
+        static JSValue Call(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
             JsResult<std::tuple<std::decay_t<TArgs>...>> optArgs = UnpackWrapper<std::decay_t<TArgs>...>::UnpackArgs(ctx, thisVal, argc, argv);
 
             if (!optArgs.IsOk())
-                return optArgs.GetErr().ToUnmanaged();
+                return std::move(optArgs).GetErr().ToUnmanaged();
+
+            std::tuple<std::decay_t<TArgs>...> args = std::move(optArgs).GetOk();
 
-            std::tuple<std::decay_t<TArgs>...> args = optArgs.GetOk();
+            auto call = [](auto &...args) -> decltype(auto) {
+                return TFun(PassArg<TArgs>(args)...);
+            };
 
             if constexpr (std::is_same_v<TReturn, void>) {
-                std::apply(TFun, args);
+                std::apply(call, args);
                 return Value::Undefined(ctx).ToUnmanaged();
             } else {
-                return Value::From(ctx, std::apply(TFun, args)).ToUnmanaged();
+                return Value::From(ctx, std::apply(call, args)).ToUnmanaged();
             }
         }
     };
@@ -91,33 +107,35 @@ namespace Qjs {
     struct FunctionWrapper<TFun> {
         static constexpr size_t ArgCount = sizeof...(TArgs);
 
-        static JSValue Invoke(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv) {
-            auto _ctx = Context::From(__ctx);
-            if (!_ctx)
-                return JS_ThrowPlainError(__ctx, "Whar");
-            auto &ctx = *_ctx;
+        static JSValue Invoke(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+            return Dispatch<Call>(ctx, this_val, argc, argv);
+        }
 
-            Value thisVal {ctx, this_val};
-            
+        /// The typed part of `Invoke`, which shared trampolines call directly.
+        static JSValue Call(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
             JsResult<std::tuple<std::decay_t<TArgs>...>> optArgs = UnpackWrapper<std::decay_t<TArgs>...>::UnpackArgs(ctx, thisVal, argc, argv);
 
             if (!optArgs.IsOk())
-                return optArgs.GetErr().ToUnmanaged();
+                return std::move(optArgs).GetErr().ToUnmanaged();
 
-            std::tuple<std::decay_t<TArgs>...> args = optArgs.GetOk();
+            std::tuple<std::decay_t<TArgs>...> args = std::move(optArgs).GetOk();
 
             auto thisRes = thisVal.As<RequireNonNull<TThis>>();
 
             if (!thisRes.IsOk())
-                return thisRes.GetErr().ToUnmanaged();
+                return std::move(thisRes).GetErr().ToUnmanaged();
+
+            TThis *_this = std::move(thisRes).GetOk();
 
-            TThis *_this = thisRes.GetOk();
+            auto call = [_this](auto &...args) -> decltype(auto) {
+                return (_this->*TFun)(PassArg<TArgs>(args)...);
+            };
 
             if constexpr (std::is_same_v<TReturn, void>) {
-                std::apply(TFun, std::tuple_cat(std::tuple<TThis *>(_this), args));
+                std::apply(call, args);
                 return Value::Undefined(ctx).ToUnmanaged();
             } else {
-                return Value::From(ctx, std::apply(TFun, std::tuple_cat(std::tuple<TThis *>(_this), args))).ToUnmanaged();
+                return Value::From(ctx, std::apply(call, args)).ToUnmanaged();
             }
         }
     };
@@ -126,47 +144,50 @@ namespace Qjs {
     struct FunctionWrapper<TFun> {
         static constexpr size_t ArgCount = sizeof...(TArgs);
 
-        static JSValue Invoke(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv) {
-            auto _ctx = Context::From(__ctx);
-            if (!_ctx)
-                return JS_ThrowPlainError(__ctx, "Whar");
-            auto &ctx = *_ctx;
+        static JSValue Invoke(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+            return Dispatch<Call>(ctx, this_val, argc, argv);
+        }
 
-            Value thisVal {ctx, this_val};
-            
+        /// The typed part of `Invoke`, which shared trampolines call directly.
+        static JSValue Call(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
             JsResult<std::tuple<std::decay_t<TArgs>...>> optArgs = UnpackWrapper<std::decay_t<TArgs>...>::UnpackArgs(ctx, thisVal, argc, argv);
 
             if (!optArgs.IsOk())
-                return optArgs.GetErr().ToUnmanaged();
+                return std::move(optArgs).GetErr().ToUnmanaged();
 
-            std::tuple<std::decay_t<TArgs>...> args = optArgs.GetOk();
+            std::tuple<std::decay_t<TArgs>...> args = std::move(optArgs).GetOk();
 
             auto thisRes = thisVal.As<RequireNonNull<TThis>>();
             
             if (!thisRes.IsOk())
-                return thisRes.GetErr().ToUnmanaged();
+                return std::move(thisRes).GetErr().ToUnmanaged();
+
+            TThis *_this = std::move(thisRes).GetOk();
 
-            TThis *_this = thisRes.GetOk();
+            auto call = [_this](auto &...args) -> decltype(auto) {
+                return (_this->*TFun)(PassArg<TArgs>(args)...);
+            };
 
             if constexpr (std::is_same_v<TReturn, void>) {
-                std::apply(TFun, std::tuple_cat(std::tuple<TThis *>(_this), args));
+                std::apply(call, args);
                 return Value::Undefined(ctx).ToUnmanaged();
             } else {
-                return Value::From(ctx, std::apply(TFun, std::tuple_cat(std::tuple<TThis *>(_this), args))).ToUnmanaged();
+                return Value::From(ctx, std::apply(call, args)).ToUnmanaged();
             }
         }
     };
 
     template <typename TClass, typename TValue, TValue (TClass::*TGetSet)>
     struct GetSetWrapper<TGetSet> {
-        static JSValue Get(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv) {
-            auto _ctx = Context::From(__ctx);
-            if (!_ctx)
-                return JS_ThrowPlainError(__ctx, "Whar");
-            auto &ctx = *_ctx;
+        static JSValue Get(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+            return Dispatch<GetCall>(ctx, this_val, argc, argv);
+        }
 
-            Value thisVal {ctx, this_val};
+        static JSValue GetCall(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
+            return GetValue(ctx, thisVal);
+        }
 
+        static JSValue GetValue(Context &ctx, ValueRef thisVal) {
             TClass *t = ClassWrapper<TClass>::Get(thisVal);
             if (!t)
                 return Value::ThrowTypeError(ctx, std::format("Expected type {}.", NameOf<TClass>())).ToUnmanaged();
@@ -176,27 +197,28 @@ namespace Qjs {
 
         template <typename = void>
             requires (!std::is_const_v<TValue>)
-        static JSValue Set(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv) {
-            auto _ctx = Context::From(__ctx);
-            if (!_ctx)
-                return JS_ThrowPlainError(__ctx, "Whar");
-            auto &ctx = *_ctx;
+        static JSValue Set(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+            return Dispatch<SetCall<>>(ctx, this_val, argc, argv);
+        }
 
-            Value thisVal {ctx, this_val};
+        template <typename = void>
+            requires (!std::is_const_v<TValue>)
+        static JSValue SetCall(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
+            return SetValue(ctx, thisVal, ValueRef(ctx, argc != 0 ? argv[0] : JS_UNDEFINED));
+        }
 
+        template <typename = void>
+            requires (!std::is_const_v<TValue>)
+        static JSValue SetValue(Context &ctx, ValueRef thisVal, ValueRef set) {
             TClass *t = ClassWrapper<TClass>::Get(thisVal);
             if (!t)
                 return Value::ThrowTypeError(ctx, std::format("Expected type {}.", NameOf<TClass>())).ToUnmanaged();
 
-            Value set {ctx, JS_UNDEFINED};
-            if (argc != 0)
-                set = Value(ctx, argv[0]);
-
             auto res = set.As<TValue>();
             if (!res.IsOk())
-                return res.GetErr().ToUnmanaged();
+                return std::move(res).GetErr().ToUnmanaged();
 
-            t->*TGetSet = res.GetOk();
+            t->*TGetSet = std::move(res).GetOk();
 
             return Value::From(ctx, t->*TGetSet).ToUnmanaged();
         }
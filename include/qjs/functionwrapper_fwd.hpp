@@ -1,6 +1,19 @@
 #pragma once
 
+#include <type_traits>
+#include <utility>
+
 namespace Qjs {
+    /// Hands an unpacked argument to a parameter of type `TParam`. Lvalue reference parameters get the
+    /// unpacked value itself, everything else gets it moved.
+    template <typename TParam, typename T>
+    constexpr decltype(auto) PassArg(T &arg) {
+        if constexpr (std::is_lvalue_reference_v<TParam>)
+            return (arg);
+        else
+            return std::move(arg);
+    }
+
     template <typename ...TArgs>
     struct UnpackWrapper;
 
@@ -9,4 +22,7 @@ namespace Qjs {
 
     template <auto TGetSet>
     struct GetSetWrapper;
+
+    template <auto TFun>
+    struct RawArgsWrapper;
 }
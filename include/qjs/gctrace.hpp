@@ -0,0 +1,89 @@
+#pragma once
+
+#include "qjs/function.hpp"
+#include "qjs/object.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <array>
+#include <map>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace Qjs {
+    /// Reports the JS values held by a `T` to the cycle collector. Specialize it for other holders of values.
+    template <typename T>
+    struct GcMark;
+
+    template <>
+    struct GcMark<Value> final {
+        static void Mark(JSRuntime *rt, Value const &value, JS_MarkFunc *mark_func) {
+            JS_MarkValue(rt, value.value, mark_func);
+        }
+    };
+
+    template <>
+    struct GcMark<Object> final {
+        static void Mark(JSRuntime *rt, Object const &value, JS_MarkFunc *mark_func) {
+            JS_MarkValue(rt, value.value.value, mark_func);
+        }
+    };
+
+    template <typename TReturn, typename ...TArgs>
+    struct GcMark<Function<TReturn, TArgs...>> final {
+        static void Mark(JSRuntime *rt, Function<TReturn, TArgs...> const &value, JS_MarkFunc *mark_func) {
+            JS_MarkValue(rt, value.value.value, mark_func);
+        }
+    };
+
+    template <typename T>
+    struct GcMark<std::optional<T>> final {
+        static void Mark(JSRuntime *rt, std::optional<T> const &value, JS_MarkFunc *mark_func) {
+            if (value)
+                GcMark<T>::Mark(rt, *value, mark_func);
+        }
+    };
+
+    template <typename T>
+    struct GcMark<std::vector<T>> final {
+        static void Mark(JSRuntime *rt, std::vector<T> const &values, JS_MarkFunc *mark_func) {
+            for (auto &value : values)
+                GcMark<T>::Mark(rt, value, mark_func);
+        }
+    };
+
+    template <typename T, size_t TLen>
+    struct GcMark<std::array<T, TLen>> final {
+        static void Mark(JSRuntime *rt, std::array<T, TLen> const &values, JS_MarkFunc *mark_func) {
+            for (auto &value : values)
+                GcMark<T>::Mark(rt, value, mark_func);
+        }
+    };
+
+    /// Only the mapped values are marked. Keys can't be traced, since they can't be changed in place.
+    template <typename TKey, typename T, typename ...TRest>
+    struct GcMark<std::map<TKey, T, TRest...>> final {
+        static void Mark(JSRuntime *rt, std::map<TKey, T, TRest...> const &values, JS_MarkFunc *mark_func) {
+            for (auto &[key, value] : values)
+                GcMark<T>::Mark(rt, value, mark_func);
+        }
+    };
+
+    template <typename TKey, typename T, typename ...TRest>
+    struct GcMark<std::unordered_map<TKey, T, TRest...>> final {
+        static void Mark(JSRuntime *rt, std::unordered_map<TKey, T, TRest...> const &values, JS_MarkFunc *mark_func) {
+            for (auto &[key, value] : values)
+                GcMark<T>::Mark(rt, value, mark_func);
+        }
+    };
+
+    /// The mark function of a class whose traced members are `TMembers`, as one unrolled sequence of calls.
+    template <auto ...TMembers>
+    struct TraceList final {
+        template <typename T>
+        static void Mark(JSRuntime *rt, T *ptr, JS_MarkFunc *mark_func) {
+            (GcMark<std::remove_cvref_t<decltype(ptr->*TMembers)>>::Mark(rt, ptr->*TMembers, mark_func), ...);
+        }
+    };
+}
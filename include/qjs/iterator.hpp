@@ -0,0 +1,299 @@
+#pragma once
+
+#include "qjs/classwrapper.hpp"
+#include "qjs/context_fwd.hpp"
+#include "qjs/conversion_fwd.hpp"
+#include "qjs/propertykey.hpp"
+#include "qjs/result_fwd.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <utility>
+
+#if __has_include(<generator>)
+#include <generator>
+#endif
+
+namespace Qjs {
+    /// `Symbol.iterator`, as an atom the caller has to free.
+    inline JSAtom SymbolIteratorAtom(Context &ctx) {
+        Value symbol = *(*Value::Global(ctx)["Symbol"_key])["iterator"_key];
+        return JS_ValueToAtom(ctx, symbol);
+    }
+
+    /// Any JS iterable (arrays, generators, `Map`s, strings, ...) as a C++ input range. Elements are pulled and
+    /// converted one at a time, so nothing is buffered.
+    ///
+    /// Each element is a `JsResult<T>`. An error (a throwing `next()` or an element that doesn't convert) is the
+    /// last element. Leaving the loop early closes the JS iterator by calling its `return()`, like `for...of` does.
+    /// Every `begin()` starts a new iteration.
+    template <typename T>
+    struct JsIterable final {
+        Value iterable;
+        Value method;
+
+        struct Iterator final {
+            using value_type = JsResult<T>;
+            using difference_type = std::ptrdiff_t;
+
+            private:
+            struct State {
+                Value iterator;
+                Value next;
+                std::optional<JsResult<T>> current {};
+                bool open = true;
+
+                State(Value &&iterator, Value &&next) : iterator(std::move(iterator)), next(std::move(next)) {}
+
+                State(State const &copy) = delete;
+
+                ~State() {
+                    if (open)
+                        Close();
+                }
+
+                void Fail(Value &&err) {
+                    current.emplace(std::move(err));
+                }
+
+                void Advance() {
+                    // An error is always the last element.
+                    if (current && !current->IsOk()) {
+                        current.reset();
+                        return;
+                    }
+
+                    Context &ctx = iterator.ctx;
+                    Value res = Value::CreateFree(ctx, JS_Call(ctx, next, iterator, 0, nullptr));
+                    if (res.IsException()) {
+                        open = false;
+                        return Fail(std::move(res));
+                    }
+                    if (!JS_IsObject(res)) {
+                        open = false;
+                        return Fail(Value::ThrowTypeError(ctx, "Iterator result is not an object"));
+                    }
+
+                    Value done = *res["done"_key];
+                    if (done.IsException()) {
+                        open = false;
+                        return Fail(std::move(done));
+                    }
+                    if (JS_ToBool(ctx, done)) {
+                        open = false;
+                        current.reset();
+                        return;
+                    }
+
+                    current.emplace((*res["value"_key]).template As<T>());
+                }
+
+                /// Errors from `return()` are dropped, since nothing is left to report them to.
+                void Close() {
+                    Context &ctx = iterator.ctx;
+
+                    Value ret = *iterator["return"_key];
+                    Value res = JS_IsFunction(ctx, ret) ? Value::CreateFree(ctx, JS_Call(ctx, ret, iterator, 0, nullptr)) : ret;
+                    if (res.IsException())
+                        JS_FreeValue(ctx, JS_GetException(ctx));
+                }
+            };
+
+            std::unique_ptr<State> state;
+
+            friend JsIterable;
+
+            public:
+            Iterator() = default;
+
+            JsResult<T> &operator * () const {
+                return *state->current;
+            }
+
+            Iterator &operator ++ () {
+                state->Advance();
+                return *this;
+            }
+
+            void operator ++ (int) {
+                ++*this;
+            }
+
+            bool operator == (std::default_sentinel_t) const {
+                return !state || !state->current;
+            }
+        };
+
+        Iterator begin() const {
+            Context &ctx = iterable.ctx;
+            Iterator it;
+
+            Value iterator = Value::CreateFree(ctx, JS_Call(ctx, method, iterable, 0, nullptr));
+            if (iterator.IsException() || !JS_IsObject(iterator)) {
+                Value err = iterator.IsException() ? std::move(iterator) : Value::ThrowTypeError(ctx, "Iterator is not an object");
+                it.state = std::make_unique<typename Iterator::State>(Value::Undefined(ctx), Value::Undefined(ctx));
+                it.state->open = false;
+                it.state->Fail(std::move(err));
+                return it;
+            }
+
+            Value next = *iterator["next"_key];
+            it.state = std::make_unique<typename Iterator::State>(std::move(iterator), std::move(next));
+            it.state->Advance();
+            return it;
+        }
+
+        std::default_sentinel_t end() const {
+            return {};
+        }
+    };
+
+    template <typename T>
+        requires Conversion<T>::Implemented
+    struct Conversion<JsIterable<T>> final {
+        static constexpr bool Implemented = true;
+
+        static Value Wrap(Context &ctx, JsIterable<T> iterable) {
+            return std::move(iterable.iterable);
+        }
+
+        static JsResult<JsIterable<T>> Unwrap(ValueRef value) {
+            Context &ctx = value.ctx;
+
+            JSAtom atom = SymbolIteratorAtom(ctx);
+            Value method = Value::CreateFree(ctx, JS_GetProperty(ctx, value, atom));
+            JS_FreeAtom(ctx, atom);
+
+            if (method.IsException())
+                return method;
+            if (!JS_IsFunction(ctx, method))
+                return Value::ThrowTypeError(ctx, "Expected iterable");
+
+            return JsIterable<T> {value.ToValue(), std::move(method)};
+        }
+    };
+
+    /// Hands a C++ input range (a view, a `std::generator`, ...) to JS as an iterator. Every `next()` advances the
+    /// range by one element and converts just that one, so infinite and single-pass ranges work.
+    /// The range is destroyed when it runs out, when the script calls `return()` (e.g. by leaving a `for...of`),
+    /// or when the iterator is collected.
+    template <std::ranges::input_range TRange>
+    struct RangeIterator final {
+        TRange range;
+    };
+
+    template <typename TRange>
+        requires Conversion<std::remove_cvref_t<std::ranges::range_reference_t<TRange>>>::Implemented
+    struct Conversion<RangeIterator<TRange>> final {
+        static constexpr bool Implemented = true;
+
+        private:
+        /// Lives at a fixed address, so `it` stays valid for ranges that don't like being moved.
+        struct State {
+            std::optional<TRange> range;
+            std::optional<std::ranges::iterator_t<TRange>> it {};
+        };
+
+        using Wrapper = ClassWrapper<State>;
+
+        static JSValue Result(Context &ctx, JSValue value, bool done) {
+            JSValue obj = JS_NewObject(ctx);
+            if (JS_IsException(obj)) {
+                JS_FreeValue(ctx, value);
+                return obj;
+            }
+
+            JS_DefinePropertyValue(ctx, obj, ctx.rt.Key<"value">(ctx).atom, value, JS_PROP_C_W_E);
+            JS_DefinePropertyValue(ctx, obj, ctx.rt.Key<"done">(ctx).atom, JS_NewBool(ctx, done), JS_PROP_C_W_E);
+            return obj;
+        }
+
+        static void Finish(State &state) {
+            state.it.reset();
+            state.range.reset();
+        }
+
+        /// `magic` is 0 for `next()` and 1 for `return()`.
+        static JSValue Step(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx)
+                return JS_ThrowPlainError(__ctx, "Whar");
+            auto &ctx = *_ctx;
+
+            ValueRef thisVal {ctx, this_val};
+            if (!Wrapper::IsThis(thisVal))
+                return JS_ThrowTypeError(ctx, "Not a range iterator");
+
+            State &state = *Wrapper::Get(thisVal);
+
+            if (magic == 1)
+                Finish(state);
+
+            if (state.range) {
+                if (state.it)
+                    ++*state.it;
+                else
+                    state.it.emplace(std::ranges::begin(*state.range));
+
+                if (*state.it == std::ranges::end(*state.range))
+                    Finish(state);
+            }
+
+            if (!state.range)
+                return Result(ctx, JS_UNDEFINED, true);
+
+            Value value = Value::From(ctx, **state.it);
+            if (value.IsException())
+                return std::move(value).ToUnmanaged();
+
+            return Result(ctx, std::move(value).ToUnmanaged(), false);
+        }
+
+        static JSValue Self(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+            return JS_DupValue(ctx, this_val);
+        }
+
+        /// Inherits from `Iterator.prototype` where the engine has it, so iterator helpers like `map` and `take` work.
+        static void SetupProto(Context &ctx) {
+            Value iteratorCtor = *Value::Global(ctx)["Iterator"_key];
+            Value proto = JS_IsObject(iteratorCtor)
+                ? Value::CreateFree(ctx, JS_NewObjectProto(ctx, iteratorCtor.Prototype()))
+                : Value::Object(ctx);
+
+            // Non-enumerable, like the methods of built-in iterators.
+            JS_DefinePropertyValue(ctx, proto, ctx.rt.Key<"next">(ctx).atom, JS_NewCFunctionMagic(ctx, Step, "next", 0, JS_CFUNC_generic_magic, 0), JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
+            JS_DefinePropertyValue(ctx, proto, ctx.rt.Key<"return">(ctx).atom, JS_NewCFunctionMagic(ctx, Step, "return", 0, JS_CFUNC_generic_magic, 1), JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
+
+            JSAtom atom = SymbolIteratorAtom(ctx);
+            JS_DefinePropertyValue(ctx, proto, atom, JS_NewCFunction(ctx, Self, "[Symbol.iterator]", 0), JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE);
+            JS_FreeAtom(ctx, atom);
+
+            Wrapper::SetProto(std::move(proto));
+        }
+
+        public:
+        static Value Wrap(Context &ctx, RangeIterator<TRange> range) {
+            Wrapper::RegisterClass(ctx, "RangeIterator");
+            if (!Wrapper::HasProto(ctx))
+                SetupProto(ctx);
+
+            return Wrapper::New(ctx, new State {std::move(range.range)});
+        }
+    };
+
+#ifdef __cpp_lib_generator
+    /// Generators become iterators that resume the coroutine on every `next()`.
+    template <typename TRef, typename TValue, typename TAlloc>
+    struct Conversion<std::generator<TRef, TValue, TAlloc>> final {
+        static constexpr bool Implemented = Conversion<RangeIterator<std::generator<TRef, TValue, TAlloc>>>::Implemented;
+
+        static Value Wrap(Context &ctx, std::generator<TRef, TValue, TAlloc> gen) {
+            return Conversion<RangeIterator<std::generator<TRef, TValue, TAlloc>>>::Wrap(ctx, {std::move(gen)});
+        }
+    };
+#endif
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Qjs {
+    /// A read-only view of a whole file.
+    /// There's always a readable zero byte right after the last byte, so the contents can be handed
+    /// to QuickJS (which wants zero terminated input) as is.
+    struct MappedFile final {
+        private:
+#ifdef _WIN32
+        std::vector<char> buffer;
+
+        MappedFile(std::vector<char> &&buffer) : buffer(std::move(buffer)) {}
+#else
+        void *base = nullptr;
+        size_t mapSize = 0;
+        size_t size = 0;
+
+        MappedFile(void *base, size_t mapSize, size_t size) : base(base), mapSize(mapSize), size(size) {}
+#endif
+
+        public:
+        MappedFile(MappedFile const &copy) = delete;
+
+#ifdef _WIN32
+        MappedFile(MappedFile &&move) = default;
+        MappedFile &operator = (MappedFile &&move) = default;
+
+        /// No mmap here yet, so the file is just read into memory.
+        static std::optional<MappedFile> Open(std::filesystem::path const &path) {
+            std::ifstream file (path, std::ios::binary | std::ios::ate);
+            if (!file)
+                return std::nullopt;
+
+            std::vector<char> buffer (size_t(file.tellg()) + 1, 0);
+            file.seekg(0);
+            if (!file.read(buffer.data(), buffer.size() - 1))
+                return std::nullopt;
+
+            return MappedFile(std::move(buffer));
+        }
+
+        char const *Data() const {
+            return buffer.data();
+        }
+
+        size_t Size() const {
+            return buffer.size() - 1;
+        }
+#else
+        MappedFile(MappedFile &&move) : base(std::exchange(move.base, nullptr)), mapSize(std::exchange(move.mapSize, 0)), size(std::exchange(move.size, 0)) {}
+
+        MappedFile &operator = (MappedFile &&move) {
+            std::swap(base, move.base);
+            std::swap(mapSize, move.mapSize);
+            std::swap(size, move.size);
+            return *this;
+        }
+
+        ~MappedFile() {
+            if (base)
+                munmap(base, mapSize);
+        }
+
+        static std::optional<MappedFile> Open(std::filesystem::path const &path) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return std::nullopt;
+
+            struct stat st;
+            if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+                close(fd);
+                return std::nullopt;
+            }
+
+            size_t size = st.st_size;
+            size_t page = sysconf(_SC_PAGESIZE);
+            size_t mapSize = (size + 1 + page - 1) / page * page;
+
+            // Reserve zeroed pages first and map the file over the start of them. If the file ends
+            // exactly on a page boundary, the terminator lands in the anonymous page that's left over.
+            void *base = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) {
+                close(fd);
+                return std::nullopt;
+            }
+
+            if (size != 0 && mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                munmap(base, mapSize);
+                close(fd);
+                return std::nullopt;
+            }
+
+            close(fd);
+
+            return MappedFile(base, mapSize, size);
+        }
+
+        char const *Data() const {
+            return static_cast<char const *>(base);
+        }
+
+        size_t Size() const {
+            return size;
+        }
+#endif
+    };
+}
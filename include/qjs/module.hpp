@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 namespace Qjs {
     struct Module final {
@@ -47,8 +48,8 @@ namespace Qjs {
         }
 
         void AddExport(std::string &&name, Value value) {
-            exports.insert({name, value});
             JS_AddModuleExport(value.ctx, mod, name.c_str());
+            exports.insert({std::move(name), std::move(value)});
         }
     };
 }
@@ -0,0 +1,417 @@
+#pragma once
+
+#include "qjs/context_fwd.hpp"
+#include "qjs/result.hpp"
+#include "qjs/typedarray.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Qjs {
+    /// MessagePack encoding of JS values, written straight from the engine's values and read straight back into new ones.
+    ///
+    /// It covers the same values as JSON, plus `Uint8Array`s, which become `bin` and come back as `Uint8Array`s.
+    /// Unlike JSON, `undefined` and functions become `nil` instead of being left out, and `BigInt`s are written
+    /// as 64-bit integers. Everything decodes to numbers, so integers past 2^53 lose precision.
+    struct MsgPack final {
+        static constexpr size_t MaxDepth = 512;
+
+        /// Appends the encoding of `value` to `out`, so a buffer can be reused across calls.
+        static JsResult<void> Encode(ValueRef value, std::vector<uint8_t> &out) {
+            Encoder encoder {value.ctx, out};
+            return encoder.Write(value, 0);
+        }
+
+        /// Returns an exception if `bytes` isn't exactly one well-formed value.
+        static Value Decode(Context &ctx, std::span<uint8_t const> bytes) {
+            Decoder decoder {ctx, bytes};
+
+            JSValue value = decoder.Read(0);
+            if (!JS_IsException(value) && decoder.pos != bytes.size()) {
+                JS_FreeValue(ctx, value);
+                value = decoder.Malformed();
+            }
+
+            return Value::CreateFree(ctx, value);
+        }
+
+        private:
+        struct Encoder {
+            Context &ctx;
+            std::vector<uint8_t> &out;
+
+            template <typename T>
+            void BigEndian(T value) {
+                for (size_t i = sizeof(T); i-- > 0;)
+                    out.push_back(uint8_t(uint64_t(value) >> (i * 8)));
+            }
+
+            /// Type byte and size for strings, binaries, arrays and maps. `fix` is the short form for small sizes, if there is one.
+            void Header(size_t size, uint8_t fix, size_t fixMax, uint8_t size8, uint8_t size16, uint8_t size32) {
+                if (fix && size <= fixMax) {
+                    out.push_back(fix | uint8_t(size));
+                } else if (size8 && size <= 0xff) {
+                    out.push_back(size8);
+                    BigEndian(uint8_t(size));
+                } else if (size <= 0xffff) {
+                    out.push_back(size16);
+                    BigEndian(uint16_t(size));
+                } else {
+                    out.push_back(size32);
+                    BigEndian(uint32_t(size));
+                }
+            }
+
+            void Int(int64_t value) {
+                if (value >= 0) {
+                    if (value < 0x80) {
+                        out.push_back(uint8_t(value));
+                    } else if (value <= 0xff) {
+                        out.push_back(0xcc);
+                        BigEndian(uint8_t(value));
+                    } else if (value <= 0xffff) {
+                        out.push_back(0xcd);
+                        BigEndian(uint16_t(value));
+                    } else if (value <= 0xffffffff) {
+                        out.push_back(0xce);
+                        BigEndian(uint32_t(value));
+                    } else {
+                        out.push_back(0xcf);
+                        BigEndian(uint64_t(value));
+                    }
+                } else {
+                    if (value >= -32) {
+                        out.push_back(uint8_t(value));
+                    } else if (value >= INT8_MIN) {
+                        out.push_back(0xd0);
+                        BigEndian(uint8_t(value));
+                    } else if (value >= INT16_MIN) {
+                        out.push_back(0xd1);
+                        BigEndian(uint16_t(value));
+                    } else if (value >= INT32_MIN) {
+                        out.push_back(0xd2);
+                        BigEndian(uint32_t(value));
+                    } else {
+                        out.push_back(0xd3);
+                        BigEndian(uint64_t(value));
+                    }
+                }
+            }
+
+            void Float(double value) {
+                // Integral doubles (which the engine produces a lot of) get the shorter integer forms.
+                if (std::trunc(value) == value && std::abs(value) < 0x1p53 && !(value == 0 && std::signbit(value))) {
+                    Int(int64_t(value));
+                } else {
+                    out.push_back(0xcb);
+                    BigEndian(std::bit_cast<uint64_t>(value));
+                }
+            }
+
+            void Bytes(uint8_t const *data, size_t size) {
+                out.insert(out.end(), data, data + size);
+            }
+
+            JsResult<void> String(JSValue str) {
+                size_t size;
+                char const *data = JS_ToCStringLen(ctx, &size, str);
+                if (!data)
+                    return Value(ctx, JS_EXCEPTION);
+
+                Header(size, 0xa0, 31, 0xd9, 0xda, 0xdb);
+                Bytes(reinterpret_cast<uint8_t const *>(data), size);
+                JS_FreeCString(ctx, data);
+                return {};
+            }
+
+            JsResult<void> Write(JSValue value, size_t depth) {
+                switch (value.tag) {
+                    case JS_TAG_INT:
+                        Int(value.u.int32);
+                        return {};
+                    case JS_TAG_FLOAT64:
+                        Float(value.u.float64);
+                        return {};
+                    case JS_TAG_BOOL:
+                        out.push_back(value.u.int32 ? 0xc3 : 0xc2);
+                        return {};
+                    case JS_TAG_STRING:
+                        return String(value);
+                    case JS_TAG_BIG_INT: {
+                        int64_t big;
+                        if (JS_ToBigInt64(ctx, &big, value) < 0)
+                            return Value(ctx, JS_EXCEPTION);
+                        Int(big);
+                        return {};
+                    }
+                    case JS_TAG_OBJECT:
+                        return Object(value, depth);
+                    default:
+                        out.push_back(0xc0);
+                        return {};
+                }
+            }
+
+            JsResult<void> Object(JSValue obj, size_t depth) {
+                if (depth >= MaxDepth)
+                    return Value::ThrowRangeError(ctx, "Value is nested too deeply");
+
+                if (JS_IsFunction(ctx, obj)) {
+                    out.push_back(0xc0);
+                    return {};
+                }
+
+                if (JS_GetTypedArrayType(obj) == JS_TYPED_ARRAY_UINT8) {
+                    auto res = TypedArray::Borrow<uint8_t>(ValueRef(ctx, obj));
+                    if (!res.IsOk())
+                        return std::move(res).GetErr();
+
+                    auto bytes = std::move(res).GetOk();
+                    Header(bytes.size(), 0, 0, 0xc4, 0xc5, 0xc6);
+                    Bytes(bytes.data(), bytes.size());
+                    return {};
+                }
+
+                if (JS_IsArray(ctx, obj)) {
+                    int64_t len;
+                    if (JS_GetLength(ctx, obj, &len) < 0)
+                        return Value(ctx, JS_EXCEPTION);
+
+                    Header(len, 0x90, 15, 0, 0xdc, 0xdd);
+                    for (int64_t i = 0; i < len; i++) {
+                        Value item = Value::CreateFree(ctx, JS_GetPropertyInt64(ctx, obj, i));
+                        if (item.IsException())
+                            return item;
+
+                        auto res = Write(item, depth + 1);
+                        if (!res.IsOk())
+                            return res;
+                    }
+                    return {};
+                }
+
+                JSPropertyEnum *props;
+                uint32_t count;
+                if (JS_GetOwnPropertyNames(ctx, &props, &count, obj, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0)
+                    return Value(ctx, JS_EXCEPTION);
+
+                JsResult<void> res {};
+
+                Header(count, 0x80, 15, 0, 0xde, 0xdf);
+                for (uint32_t i = 0; i < count && res.IsOk(); i++) {
+                    Value key = Value::CreateFree(ctx, JS_AtomToString(ctx, props[i].atom));
+                    Value item = Value::CreateFree(ctx, JS_GetProperty(ctx, obj, props[i].atom));
+                    if (key.IsException() || item.IsException()) {
+                        res = Value(ctx, JS_EXCEPTION);
+                        break;
+                    }
+
+                    res = String(key);
+                    if (res.IsOk())
+                        res = Write(item, depth + 1);
+                }
+
+                JS_FreePropertyEnum(ctx, props, count);
+                return res;
+            }
+        };
+
+        struct Decoder {
+            Context &ctx;
+            std::span<uint8_t const> bytes;
+            size_t pos = 0;
+
+            JSValue Malformed() {
+                return JS_ThrowRangeError(ctx, "Malformed MessagePack");
+            }
+
+            bool Has(size_t size) const {
+                return bytes.size() - pos >= size;
+            }
+
+            /// Reads an unsigned big-endian integer. The caller checks `Has` first.
+            template <typename T>
+            T BigEndian() {
+                T value = 0;
+                for (size_t i = 0; i < sizeof(T); i++)
+                    value = T(value << 8) | bytes[pos++];
+                return value;
+            }
+
+            /// Reads the size that follows a `*8`/`*16`/`*32` type byte, where `width` is 1, 2 or 4 bytes.
+            bool Size(size_t width, size_t &size) {
+                if (!Has(width))
+                    return false;
+                size = width == 1 ? BigEndian<uint8_t>() : width == 2 ? BigEndian<uint16_t>() : BigEndian<uint32_t>();
+                return true;
+            }
+
+            JSValue String(size_t size) {
+                if (!Has(size))
+                    return Malformed();
+                JSValue str = JS_NewStringLen(ctx, reinterpret_cast<char const *>(bytes.data() + pos), size);
+                pos += size;
+                return str;
+            }
+
+            JSValue Binary(size_t size) {
+                if (!Has(size))
+                    return Malformed();
+
+                JSValue buffer = JS_NewArrayBufferCopy(ctx, bytes.data() + pos, size);
+                pos += size;
+                if (JS_IsException(buffer))
+                    return buffer;
+
+                std::array<JSValue, 3> args {buffer, JS_NewInt64(ctx, 0), JS_NewInt64(ctx, size)};
+                JSValue arr = JS_NewTypedArray(ctx, args.size(), args.data(), JS_TYPED_ARRAY_UINT8);
+                JS_FreeValue(ctx, buffer);
+                return arr;
+            }
+
+            JSValue Array(size_t size, size_t depth) {
+                // Every element takes at least a byte, which keeps a bogus size from allocating anything.
+                if (!Has(size))
+                    return Malformed();
+
+                JSValue arr = JS_NewArray(ctx);
+                for (size_t i = 0; i < size && !JS_IsException(arr); i++) {
+                    JSValue item = Read(depth + 1);
+                    if (JS_IsException(item) || JS_DefinePropertyValueUint32(ctx, arr, i, item, JS_PROP_C_W_E) < 0) {
+                        JS_FreeValue(ctx, arr);
+                        return JS_EXCEPTION;
+                    }
+                }
+                return arr;
+            }
+
+            /// String keys become atoms directly, without creating a string value first.
+            JSAtom Key(size_t depth) {
+                if (!Has(1))
+                    return JS_ATOM_NULL;
+
+                uint8_t type = bytes[pos];
+                size_t size;
+                bool isStr = true;
+
+                if ((type & 0xe0) == 0xa0) {
+                    pos++;
+                    size = type & 0x1f;
+                } else if (type >= 0xd9 && type <= 0xdb) {
+                    pos++;
+                    if (!Size(size_t(1) << (type - 0xd9), size))
+                        return JS_ATOM_NULL;
+                } else {
+                    isStr = false;
+                }
+
+                if (isStr) {
+                    if (!Has(size))
+                        return JS_ATOM_NULL;
+                    JSAtom atom = JS_NewAtomLen(ctx, reinterpret_cast<char const *>(bytes.data() + pos), size);
+                    pos += size;
+                    return atom;
+                }
+
+                JSValue key = Read(depth + 1);
+                if (JS_IsException(key))
+                    return JS_ATOM_NULL;
+
+                JSAtom atom = JS_ValueToAtom(ctx, key);
+                JS_FreeValue(ctx, key);
+                return atom;
+            }
+
+            JSValue Map(size_t size, size_t depth) {
+                if (!Has(size))
+                    return Malformed();
+
+                JSValue obj = JS_NewObject(ctx);
+                for (size_t i = 0; i < size && !JS_IsException(obj); i++) {
+                    JSAtom key = Key(depth);
+                    if (key == JS_ATOM_NULL) {
+                        JS_FreeValue(ctx, obj);
+                        return JS_HasException(ctx) ? JS_EXCEPTION : Malformed();
+                    }
+
+                    JSValue item = Read(depth + 1);
+                    int ok = JS_IsException(item) ? -1 : JS_DefinePropertyValue(ctx, obj, key, item, JS_PROP_C_W_E);
+                    JS_FreeAtom(ctx, key);
+
+                    if (ok < 0) {
+                        JS_FreeValue(ctx, obj);
+                        return JS_EXCEPTION;
+                    }
+                }
+                return obj;
+            }
+
+            JSValue Read(size_t depth) {
+                if (depth >= MaxDepth)
+                    return JS_ThrowRangeError(ctx, "MessagePack is nested too deeply");
+                if (!Has(1))
+                    return Malformed();
+
+                uint8_t type = bytes[pos++];
+                size_t size;
+
+                if (type < 0x80)
+                    return JS_NewInt32(ctx, type);
+                if (type >= 0xe0)
+                    return JS_NewInt32(ctx, int8_t(type));
+                if ((type & 0xf0) == 0x80)
+                    return Map(type & 0x0f, depth);
+                if ((type & 0xf0) == 0x90)
+                    return Array(type & 0x0f, depth);
+                if ((type & 0xe0) == 0xa0)
+                    return String(type & 0x1f);
+
+                switch (type) {
+                    case 0xc0:
+                        return JS_NULL;
+                    case 0xc2:
+                        return JS_FALSE;
+                    case 0xc3:
+                        return JS_TRUE;
+                    case 0xc4: case 0xc5: case 0xc6:
+                        return Size(size_t(1) << (type - 0xc4), size) ? Binary(size) : Malformed();
+                    case 0xca:
+                        return Has(4) ? JS_NewFloat64(ctx, std::bit_cast<float>(BigEndian<uint32_t>())) : Malformed();
+                    case 0xcb:
+                        return Has(8) ? JS_NewFloat64(ctx, std::bit_cast<double>(BigEndian<uint64_t>())) : Malformed();
+                    case 0xcc:
+                        return Has(1) ? JS_NewInt32(ctx, BigEndian<uint8_t>()) : Malformed();
+                    case 0xcd:
+                        return Has(2) ? JS_NewInt32(ctx, BigEndian<uint16_t>()) : Malformed();
+                    case 0xce:
+                        return Has(4) ? JS_NewInt64(ctx, BigEndian<uint32_t>()) : Malformed();
+                    case 0xcf:
+                        return Has(8) ? JS_NewFloat64(ctx, double(BigEndian<uint64_t>())) : Malformed();
+                    case 0xd0:
+                        return Has(1) ? JS_NewInt32(ctx, int8_t(BigEndian<uint8_t>())) : Malformed();
+                    case 0xd1:
+                        return Has(2) ? JS_NewInt32(ctx, int16_t(BigEndian<uint16_t>())) : Malformed();
+                    case 0xd2:
+                        return Has(4) ? JS_NewInt32(ctx, int32_t(BigEndian<uint32_t>())) : Malformed();
+                    case 0xd3:
+                        return Has(8) ? JS_NewInt64(ctx, int64_t(BigEndian<uint64_t>())) : Malformed();
+                    case 0xd9: case 0xda: case 0xdb:
+                        return Size(size_t(1) << (type - 0xd9), size) ? String(size) : Malformed();
+                    case 0xdc: case 0xdd:
+                        return Size(size_t(2) << (type - 0xdc), size) ? Array(size, depth) : Malformed();
+                    case 0xde: case 0xdf:
+                        return Size(size_t(2) << (type - 0xde), size) ? Map(size, depth) : Malformed();
+                    default:
+                        // Extension types and the reserved 0xc1.
+                        return Malformed();
+                }
+            }
+        };
+    };
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "qjs/classwrapper_fwd.hpp"
+#include "qjs/context_fwd.hpp"
+#include "qjs/conversion.hpp"
+#include "qjs/conversion_fwd.hpp"
+#include "qjs/function.hpp"
+#include "qjs/functionwrapper.hpp"
+#include "qjs/functionwrapper_fwd.hpp"
+#include "qjs/object.hpp"
+#include "qjs/stringview.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <format>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Qjs {
+    /// A cheap check of whether a JS value could be unwrapped as a `T`, for picking an overload.
+    /// It only looks at tags and class ids, and never converts or throws. Types that unwrap from anything
+    /// (e.g. `bool`, `std::string` or `Value`) match anything.
+    template <typename T>
+    struct ArgShape final {
+        static bool Matches(ValueRef value) {
+            if constexpr (requires { Conversion<T>::ValidValue(value); })
+                return Conversion<T>::ValidValue(value);
+            else
+                return true;
+        }
+    };
+
+    template <typename T>
+    struct ArgShape<std::optional<T>> final {
+        static bool Matches(ValueRef value) {
+            return value.IsNullish() || ArgShape<T>::Matches(value);
+        }
+    };
+
+    template <typename T>
+        requires (std::is_base_of_v<ManagedClass, T> || std::is_base_of_v<UnmanagedClass, T>)
+    struct ArgShape<T *> final {
+        static bool Matches(ValueRef value) {
+            return value.IsNullish() || ClassWrapper<T>::IsThis(value);
+        }
+    };
+
+    template <typename T>
+    struct ArgShape<RequireNonNull<T>> final {
+        static bool Matches(ValueRef value) {
+            return ClassWrapper<T>::IsThis(value);
+        }
+    };
+
+    template <typename T>
+        requires std::is_base_of_v<ManagedClass, T>
+    struct ArgShape<T> final {
+        static bool Matches(ValueRef value) {
+            return ClassWrapper<T>::IsThis(value);
+        }
+    };
+
+    template <typename T>
+    struct ArgShape<PassJsThis<T>> final {
+        static bool Matches(ValueRef value) {
+            return ArgShape<T>::Matches(value);
+        }
+    };
+
+    template <>
+    struct ArgShape<JsStringView> final {
+        static bool Matches(ValueRef value) {
+            return JS_IsString(value);
+        }
+    };
+
+    template <>
+    struct ArgShape<Object> final {
+        static bool Matches(ValueRef value) {
+            return JS_IsObject(value);
+        }
+    };
+
+    template <typename TReturn, typename ...TArgs>
+    struct ArgShape<Function<TReturn, TArgs...>> final {
+        static bool Matches(ValueRef value) {
+            return JS_IsFunction(value.ctx, value);
+        }
+    };
+
+    template <typename T>
+    struct ArgShape<std::vector<T>> final {
+        static bool Matches(ValueRef value) {
+            return JS_IsObject(value);
+        }
+    };
+
+    template <typename T, size_t TLen>
+    struct ArgShape<std::array<T, TLen>> final {
+        static bool Matches(ValueRef value) {
+            return JS_IsObject(value);
+        }
+    };
+
+    /// The JS-visible parameters of a bound function. A leading `Value` parameter gets `this`, like in `UnpackWrapper`.
+    template <typename TArgs>
+    struct ParamShape;
+
+    template <typename ...TArgs>
+    struct ParamShape<std::tuple<TArgs...>> {
+        static constexpr size_t Arity = sizeof...(TArgs);
+
+        static bool Matches(Context &ctx, int argc, JSValue *argv) {
+            return [&]<size_t ...TIndices>(std::index_sequence<TIndices...>) {
+                return (ArgShape<TArgs>::Matches(ValueRef(ctx, int(TIndices) < argc ? argv[TIndices] : JS_UNDEFINED)) && ...);
+            }(std::index_sequence_for<TArgs...>());
+        }
+    };
+
+    template <typename ...TArgs>
+    struct ParamShape<std::tuple<Value, TArgs...>> : ParamShape<std::tuple<TArgs...>> {};
+
+    template <auto TFun>
+    struct OverloadSignature;
+
+    template <typename TReturn, typename ...TArgs, TReturn (*TFun)(TArgs...)>
+    struct OverloadSignature<TFun> : ParamShape<std::tuple<std::decay_t<TArgs>...>> {};
+
+    template <typename TReturn, typename TThis, typename ...TArgs, TReturn (TThis::*TFun)(TArgs...)>
+    struct OverloadSignature<TFun> : ParamShape<std::tuple<std::decay_t<TArgs>...>> {};
+
+    template <typename TReturn, typename TThis, typename ...TArgs, TReturn (TThis::*TFun)(TArgs...) const>
+    struct OverloadSignature<TFun> : ParamShape<std::tuple<std::decay_t<TArgs>...>> {};
+
+    /// One JS function backed by several C++ functions. A call goes to the first one whose parameters match the
+    /// arguments' types (see `ArgShape`), without converting anything up front, and only throws once if none does.
+    ///
+    /// Candidates are tried in an order that's worked out at compile time for each argument count: exact arity
+    /// first, then ones with more parameters (the rest are `undefined`), then ones with fewer (the extra arguments
+    /// are ignored). Ties go to whichever is listed first, so put the more specific overloads first.
+    /// Overloaded C++ names have to be picked out with a cast, e.g. `static_cast<int (A::*)(int)>(&A::f)`.
+    template <auto ...TFuns>
+    struct OverloadWrapper final {
+        static_assert(sizeof...(TFuns) != 0, "An overload set needs at least one function");
+
+        static constexpr size_t Count = sizeof...(TFuns);
+        static constexpr size_t ArgCount = std::max({OverloadSignature<TFuns>::Arity...});
+
+        private:
+        struct Candidate {
+            size_t arity;
+            bool (*matches)(Context &, int, JSValue *);
+            JSValue (*call)(Context &, ValueRef, int, JSValue *);
+        };
+
+        static constexpr std::array<Candidate, Count> Candidates {{
+            {OverloadSignature<TFuns>::Arity, &OverloadSignature<TFuns>::Matches, &FunctionWrapper<TFuns>::Call}...
+        }};
+
+        /// `Order[argc]` lists candidate indices in the order they're tried. The last row is for every
+        /// argument count above `ArgCount`.
+        static constexpr auto Order = [] {
+            auto rank = [](size_t arity, size_t argc) -> size_t {
+                if (arity == argc)
+                    return 0;
+                if (arity > argc)
+                    return arity - argc;
+                return ArgCount + 1 + argc - arity;
+            };
+
+            std::array<std::array<size_t, Count>, ArgCount + 2> order {};
+
+            for (size_t argc = 0; argc < order.size(); argc++) {
+                auto &row = order[argc];
+
+                // Insertion sort, since it's stable and usable in constant expressions.
+                for (size_t i = 0; i < Count; i++) {
+                    size_t j = i;
+                    for (; j > 0 && rank(Candidates[row[j - 1]].arity, argc) > rank(Candidates[i].arity, argc); j--)
+                        row[j] = row[j - 1];
+                    row[j] = i;
+                }
+            }
+
+            return order;
+        }();
+
+        static char const *TypeName(ValueRef value) {
+            if (JS_IsFunction(value.ctx, value))
+                return "function";
+
+            if (JS_IsUndefined(value))
+                return "undefined";
+            if (JS_IsNull(value))
+                return "null";
+            if (JS_IsBool(value))
+                return "boolean";
+            if (JS_IsNumber(value))
+                return "number";
+            if (JS_IsString(value))
+                return "string";
+            if (JS_IsSymbol(value))
+                return "symbol";
+            if (JS_IsObject(value))
+                return "object";
+            return "bigint";
+        }
+
+        public:
+        static JSValue Invoke(JSContext *ctx, JSValue this_val, int argc, JSValue *argv) {
+            return Dispatch<Call>(ctx, this_val, argc, argv);
+        }
+
+        static JSValue Call(Context &ctx, ValueRef thisVal, int argc, JSValue *argv) {
+            for (size_t i : Order[std::min<size_t>(argc, ArgCount + 1)]) {
+                auto &candidate = Candidates[i];
+                if (candidate.matches(ctx, argc, argv))
+                    return candidate.call(ctx, thisVal, argc, argv);
+            }
+
+            std::string types;
+            for (int i = 0; i < argc; i++) {
+                if (i != 0)
+                    types += ", ";
+                types += TypeName(ValueRef(ctx, argv[i]));
+            }
+
+            return Value::ThrowTypeError(ctx, std::format("No overload matches the arguments ({}).", types)).ToUnmanaged();
+        }
+    };
+}
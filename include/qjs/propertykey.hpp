@@ -0,0 +1,35 @@
+#pragma once
+
+#include "qjs/util.hpp"
+#include "quickjs.h"
+#include <atomic>
+#include <cstddef>
+
+namespace Qjs {
+    /// A property name that's already been turned into an atom, so accessing the property doesn't hash the name again.
+    /// The atom belongs to the runtime it was interned in (see `Runtime::Intern`), and is valid as long as that runtime.
+    struct PropertyKey final {
+        JSAtom atom;
+    };
+
+    inline std::atomic<size_t> nextKeySlot = 0;
+
+    /// A property name known at compile time, like `"length"_key`.
+    /// Every name gets a slot, so looking its atom up in a runtime is just indexing an array.
+    template <FixedString TName>
+    struct StaticKey final {
+        static constexpr FixedString Name = TName;
+
+        static size_t Slot() {
+            static size_t const slot = nextKeySlot++;
+            return slot;
+        }
+    };
+
+    inline namespace Literals {
+        template <FixedString TName>
+        constexpr StaticKey<TName> operator ""_key() {
+            return {};
+        }
+    }
+}
@@ -1,34 +1,70 @@
 #pragma once
 
 #include "result_fwd.hpp"
+#include <functional>
 #include <optional>
+#include <type_traits>
+#include <utility>
 #include "value_fwd.hpp"
 
 namespace Qjs {
     template <typename T>
-    Value JsResult<T>::GetErr() {
-        return std::get<1>(Values);
+    Value JsResult<T>::GetErr() const & {
+        return result.error();
+    }
+
+    template <typename T>
+    Value JsResult<T>::GetErr() && {
+        return std::move(result.error());
     }
 
     template <>
-    struct JsResult<void> {
-        std::optional<Value> const Values;
+    struct [[nodiscard]] JsResult<void> final {
+        private:
+        std::optional<Value> error;
 
-        JsResult() : Values(std::nullopt) {}
-        JsResult(Value &&err) : Values({err}) {}
-        JsResult(Value const &err) : Values({err}) {}
+        public:
+        JsResult() : error(std::nullopt) {}
+        JsResult(Value &&err) : error(std::move(err)) {}
+        JsResult(Value const &err) : error(err) {}
 
-        bool IsOk() {
-            return !Values.has_value();
+        bool IsOk() const {
+            return !error.has_value();
         }
 
-        void GetOk() noexcept(false) {
+        void GetOk() const noexcept(false) {
             if (!IsOk())
                 throw GetErr();
         }
 
-        struct Value GetErr() {
-            return *Values;
+        Value GetErr() const & {
+            return *error;
+        }
+
+        Value GetErr() && {
+            return std::move(*error);
+        }
+
+        template <typename TFun>
+        auto AndThen(TFun &&fun) && -> std::invoke_result_t<TFun> {
+            if (!IsOk())
+                return std::move(*this).GetErr();
+            return std::invoke(std::forward<TFun>(fun));
+        }
+
+        template <typename TFun>
+        auto Transform(TFun &&fun) && -> JsResult<std::invoke_result_t<TFun>> {
+            using TOut = std::invoke_result_t<TFun>;
+
+            if (!IsOk())
+                return std::move(*this).GetErr();
+
+            if constexpr (std::is_void_v<TOut>) {
+                std::invoke(std::forward<TFun>(fun));
+                return {};
+            } else {
+                return std::invoke(std::forward<TFun>(fun));
+            }
         }
     };
 }
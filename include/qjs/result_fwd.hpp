@@ -1,35 +1,87 @@
 #pragma once
 
-#include <variant>
+#include <expected>
+#include <functional>
+#include <type_traits>
+#include <utility>
 namespace Qjs {
     struct Value;
 
     template <typename T>
-    struct JsResult final {
+    struct JsResult;
+
+    /// Either a `T` or the exception that was thrown instead.
+    /// The accessors have `&&` overloads that move out of the result, so `std::move(res).GetOk()` doesn't copy.
+    template <typename T>
+    struct [[nodiscard]] JsResult final {
         private:
-        std::variant<T, Value> const Values;
+        std::expected<T, Value> result;
 
         public:
-        JsResult(T ok) : Values({ok}) {}
-        JsResult(Value &&err) : Values({err}) {}
-        JsResult(Value const &err) : Values({err}) {}
+        JsResult(T ok) : result(std::in_place, std::move(ok)) {}
+        JsResult(Value &&err) : result(std::unexpect, std::move(err)) {}
+        JsResult(Value const &err) : result(std::unexpect, err) {}
+
+        bool IsOk() const {
+            return result.has_value();
+        }
 
-        bool IsOk() {
-            return Values.index() == 0;
+        T &GetOk() & noexcept(false) {
+            if (!IsOk())
+                throw GetErr();
+            return *result;
         }
 
-        T GetOk() noexcept(false) {
+        T const &GetOk() const & noexcept(false) {
             if (!IsOk())
                 throw GetErr();
-            return std::get<0>(Values);
+            return *result;
+        }
+
+        T GetOk() && noexcept(false) {
+            if (!IsOk())
+                throw std::move(*this).GetErr();
+            return std::move(*result);
+        }
+
+        T OkOr(T other) const & {
+            if (IsOk())
+                return *result;
+            return other;
         }
 
-        T OkOr(T &&other) {
+        T OkOr(T other) && {
             if (IsOk())
-                return GetOk();
+                return std::move(*result);
             return other;
         }
 
-        Value GetErr();
+        Value GetErr() const &;
+
+        Value GetErr() &&;
+
+        /// Calls `fun` with the value, which returns another `JsResult`. Errors are passed through.
+        template <typename TFun>
+        auto AndThen(TFun &&fun) && -> std::invoke_result_t<TFun, T &&> {
+            if (!IsOk())
+                return std::move(*this).GetErr();
+            return std::invoke(std::forward<TFun>(fun), std::move(*result));
+        }
+
+        /// Calls `fun` with the value and wraps whatever it returns. Errors are passed through.
+        template <typename TFun>
+        auto Transform(TFun &&fun) && -> JsResult<std::invoke_result_t<TFun, T &&>> {
+            using TOut = std::invoke_result_t<TFun, T &&>;
+
+            if (!IsOk())
+                return std::move(*this).GetErr();
+
+            if constexpr (std::is_void_v<TOut>) {
+                std::invoke(std::forward<TFun>(fun), std::move(*result));
+                return {};
+            } else {
+                return std::invoke(std::forward<TFun>(fun), std::move(*result));
+            }
+        }
     };
 }
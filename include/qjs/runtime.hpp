@@ -1,5 +1,6 @@
 #pragma once
 
+#include "qjs/bytecodecache.hpp"
 #include "qjs/context_fwd.hpp"
 #include "quickjs.h"
 #include "runtime_fwd.hpp"
@@ -41,14 +42,24 @@ namespace Qjs {
 
         std::string requestedSource = requestedSourceCstr;
 
-        std::optional<std::string> src = TLoad(ctx, requestedSource);
+        std::optional<Value> res = ctx.LoadBundled(requestedSource);
 
-        if (!src)
-            return nullptr;
+        if (!res) {
+            auto src = TLoad(ctx, requestedSource);
+
+            if (!src)
+                return nullptr;
 
-        auto res = ctx.Eval(*src, requestedSource, JS_EVAL_FLAG_COMPILE_ONLY);
+            if (ctx.rt.bytecodeCache)
+                res.emplace(ctx.rt.bytecodeCache->Compile(ctx, *src, requestedSource));
+            else
+                res.emplace(ctx.Eval(*src, requestedSource, JS_EVAL_FLAG_COMPILE_ONLY));
+        }
+
+        if (res->IsException())
+            return nullptr;
 
-        JSModuleDef *mod = reinterpret_cast<JSModuleDef *>(JS_VALUE_GET_PTR(res.value));
+        JSModuleDef *mod = reinterpret_cast<JSModuleDef *>(JS_VALUE_GET_PTR(res->value));
 
         auto metaVal = JS_GetImportMeta(ctx, mod);
 
@@ -1,10 +1,63 @@
 #pragma once
 
+#include "qjs/propertykey.hpp"
+#include "qjs/slabpool.hpp"
+#include "qjs/util.hpp"
 #include "quickjs.h"
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+#include <vector>
 
 namespace Qjs {
+    struct BytecodeCache;
+
+    /// Lets `std::string` keyed maps be searched with a `std::string_view`, without building a string first.
+    struct StringHash {
+        using is_transparent = void;
+
+        size_t operator () (std::string_view str) const {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    /// Wrappers are per context, since each context has its own class prototypes.
+    struct WrapperKey {
+        JSContext *ctx;
+        JSClassID classId;
+        void const *ptr;
+
+        bool operator == (WrapperKey const &other) const = default;
+    };
+
+    struct WrapperKeyHash {
+        size_t operator () (WrapperKey const &key) const {
+            size_t hash = std::hash<void const *>{}(key.ptr) ^ (size_t(key.classId) * 0x9e3779b97f4a7c15);
+            return hash ^ (std::hash<JSContext *>{}(key.ctx) * 0xbf58476d1ce4e5b9);
+        }
+    };
+
     struct Runtime final {
         JSRuntime *rt;
+        BytecodeCache *bytecodeCache = nullptr;
+
+        /// Every atom interned so far. `keySlots` holds the same atoms, indexed by `StaticKey::Slot`.
+        std::unordered_map<std::string, JSAtom, StringHash, std::equal_to<>> atoms;
+        std::vector<JSAtom> keySlots;
+
+        /// Wrappers of classes that keep their identity (see `ClassBuilder::KeepIdentity`), by context, class and
+        /// native pointer. The references are weak: finalizing a wrapper removes its entry.
+        std::unordered_map<WrapperKey, JSValue, WrapperKeyHash> wrappers;
+
+        /// The key of every wrapper in `wrappers`, by object. Finalizers aren't told the object's context.
+        std::unordered_map<void const *, WrapperKey> wrapperKeys;
+
+        /// Instance pools of classes with `ClassAllocTraits<T>::Pooled`, indexed by class id. They're destroyed
+        /// after `JS_FreeRuntime`, so the finalizers it runs can still give their blocks back.
+        std::vector<std::unique_ptr<SlabPool>> pools;
 
         Runtime(bool debug = false) {
             rt = JS_NewRuntime();
@@ -16,6 +69,8 @@ namespace Qjs {
         Runtime(Runtime const &copy) = delete;
 
         ~Runtime() {
+            for (auto &[name, atom] : atoms)
+                JS_FreeAtomRT(rt, atom);
             JS_FreeRuntime(rt);
         }
 
@@ -35,11 +90,57 @@ namespace Qjs {
         static JSModuleDef *Load(JSContext *ctx, const char *requestedSourceCstr, void *opaque);
 
         public:
+        /// `TNormalize(Context &, std::string requesting, std::string requested)` returns the resolved module name.
+        /// `TLoad(Context &, std::string const &name)` returns an optional `std::string` or `Source` (e.g. `LoadFile`),
+        /// which is compiled without being copied again.
         template <auto TNromalize, auto TLoad>
         void SetModuleLoaderFunc() {
             JS_SetModuleLoaderFunc(rt, Normalize<TNromalize>, Load<TLoad>, nullptr);
         }
 
+        /// Makes the module loader go through `cache`. Pass `nullptr` to compile from source every time.
+        /// The cache isn't owned, and has to outlive the runtime.
+        void SetBytecodeCache(BytecodeCache *cache) {
+            bytecodeCache = cache;
+        }
+
+        /// Gets the atom for `name`, creating it the first time. Atoms are shared by every context in the runtime,
+        /// and only freed with it.
+        PropertyKey Intern(JSContext *ctx, std::string_view name) {
+            if (auto it = atoms.find(name); it != atoms.end())
+                return {it->second};
+
+            JSAtom atom = JS_NewAtomLen(ctx, name.data(), name.size());
+            if (atom != JS_ATOM_NULL)
+                atoms.emplace(name, atom);
+            return {atom};
+        }
+
+        /// Same as `Intern`, but for a name known at compile time, which skips hashing it after the first time.
+        template <FixedString TName>
+        PropertyKey Key(JSContext *ctx) {
+            size_t slot = StaticKey<TName>::Slot();
+            if (slot < keySlots.size() && keySlots[slot] != JS_ATOM_NULL)
+                return {keySlots[slot]};
+
+            PropertyKey key = Intern(ctx, TName.View());
+            if (key.atom != JS_ATOM_NULL) {
+                if (slot >= keySlots.size())
+                    keySlots.resize(slot + 1, JS_ATOM_NULL);
+                keySlots[slot] = key.atom;
+            }
+            return key;
+        }
+
+        /// The instance pool of class `id`, created on first use.
+        SlabPool &Pool(JSClassID id, size_t size, size_t align) {
+            if (id >= pools.size())
+                pools.resize(id + 1);
+            if (!pools[id])
+                pools[id] = std::make_unique<SlabPool>(size, align);
+            return *pools[id];
+        }
+
         void Gc() {
             JS_RunGC(rt);
         }
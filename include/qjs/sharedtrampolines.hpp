@@ -0,0 +1,126 @@
+#pragma once
+
+#include "qjs/context_fwd.hpp"
+#include "qjs/functionwrapper.hpp"
+#include "qjs/functionwrapper_fwd.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace Qjs {
+    /// Bindings that share one native entry point per shape (call, get, set) instead of having one each.
+    /// The entry point finds the `Context` and jumps through a table to the binding's typed thunk, which it picks
+    /// by the function's magic number. That keeps the prologue and error paths in one place, and every binding
+    /// down to its conversions and the call itself.
+    ///
+    /// Define `QJS_CPP_SHARED_TRAMPOLINES` to use them for `Value::Function`, `ClassBuilder` fields and methods,
+    /// and `FunctionList`s. They can also be used directly without it.
+    struct SharedTrampolines final {
+        using CallThunk = JSValue (*)(Context &, ValueRef, int, JSValue *);
+        using GetThunk = JSValue (*)(Context &, ValueRef);
+        using SetThunk = JSValue (*)(Context &, ValueRef, ValueRef);
+
+        /// Getters and setters share one slot, since `JS_CGETSET_MAGIC_DEF` gives both the same magic number.
+        struct Accessor {
+            GetThunk get;
+            SetThunk set;
+        };
+
+        /// `JSCFunctionListEntry` stores the magic number as an `int16_t`.
+        static constexpr size_t Capacity = 32768;
+
+        private:
+        /// Slots are only ever appended, and an index is only handed out after its slot is written, so reading
+        /// needs no lock. The table is zero initialized, so untouched slots cost no memory.
+        template <typename TThunk>
+        struct Table {
+            inline static std::array<TThunk, Capacity> thunks {};
+            inline static std::atomic<size_t> count = 0;
+
+            static int Add(TThunk thunk) {
+                size_t index = count.fetch_add(1);
+                if (index >= Capacity)
+                    throw std::length_error("Too many bindings for shared trampolines");
+
+                thunks[index] = thunk;
+                return int(index);
+            }
+        };
+
+        template <auto TField>
+        struct FieldThunks {
+            static constexpr SetThunk Set() {
+                if constexpr (requires { &GetSetWrapper<TField>::template SetValue<>; })
+                    return &GetSetWrapper<TField>::template SetValue<>;
+                else
+                    return nullptr;
+            }
+        };
+
+        public:
+        static JSValue Call(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx)
+                return JS_ThrowPlainError(__ctx, "Whar");
+            auto &ctx = *_ctx;
+
+            return Table<CallThunk>::thunks[magic](ctx, ValueRef(ctx, this_val), argc, argv);
+        }
+
+        static JSValue Get(JSContext *__ctx, JSValue this_val, int magic) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx)
+                return JS_ThrowPlainError(__ctx, "Whar");
+            auto &ctx = *_ctx;
+
+            return Table<Accessor>::thunks[magic].get(ctx, ValueRef(ctx, this_val));
+        }
+
+        static JSValue Set(JSContext *__ctx, JSValue this_val, JSValue val, int magic) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx)
+                return JS_ThrowPlainError(__ctx, "Whar");
+            auto &ctx = *_ctx;
+
+            return Table<Accessor>::thunks[magic].set(ctx, ValueRef(ctx, this_val), ValueRef(ctx, val));
+        }
+
+        template <auto TFun>
+        static int CallIndex() {
+            static int const index = Table<CallThunk>::Add(&FunctionWrapper<TFun>::Call);
+            return index;
+        }
+
+        /// Const fields have no setter.
+        template <auto TField>
+        static int AccessorIndex() {
+            static int const index = Table<Accessor>::Add({&GetSetWrapper<TField>::GetValue, FieldThunks<TField>::Set()});
+            return index;
+        }
+
+        template <auto TFun>
+        static Value Function(Context &ctx, std::string const &name) {
+            return Value::CreateFree(ctx, JS_NewCFunctionMagic(ctx, Call, name.c_str(), FunctionWrapper<TFun>::ArgCount, JS_CFUNC_generic_magic, CallIndex<TFun>()));
+        }
+
+        /// Accessor functions for `JS_DefinePropertyGetSet`. The engine's getter and setter calling conventions
+        /// are selected the same way `JS_NewCFunctionMagic` does it, through `JSCFunctionType`.
+        template <auto TField>
+        static Value Getter(Context &ctx, std::string const &name) {
+            JSCFunctionType fn;
+            fn.getter_magic = Get;
+            return Value::CreateFree(ctx, JS_NewCFunction2(ctx, fn.generic, name.c_str(), 0, JS_CFUNC_getter_magic, AccessorIndex<TField>()));
+        }
+
+        template <auto TField>
+        static Value Setter(Context &ctx, std::string const &name) {
+            JSCFunctionType fn;
+            fn.setter_magic = Set;
+            return Value::CreateFree(ctx, JS_NewCFunction2(ctx, fn.generic, name.c_str(), 1, JS_CFUNC_setter_magic, AccessorIndex<TField>()));
+        }
+    };
+}
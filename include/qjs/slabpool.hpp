@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace Qjs {
+    /// Hands out fixed-size blocks carved from larger slabs, and keeps freed blocks on a free list for reuse.
+    /// Slabs are only returned to the system when the pool is destroyed. Not thread-safe, just like the runtime it belongs to.
+    struct SlabPool final {
+        struct Stats {
+            size_t live = 0;
+            size_t peak = 0;
+            size_t allocations = 0;
+            size_t reused = 0;
+            size_t slabs = 0;
+            size_t bytes = 0;
+        };
+
+        private:
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        static constexpr size_t FirstSlabBlocks = 64;
+        static constexpr size_t MaxSlabBlocks = 4096;
+
+        size_t const align;
+        size_t const blockSize;
+
+        std::vector<void *> slabs {};
+        FreeBlock *freeList = nullptr;
+        std::byte *bump = nullptr;
+        size_t bumpLeft = 0;
+        size_t nextSlabBlocks = FirstSlabBlocks;
+        Stats stats {};
+
+        void Grow() {
+            size_t size = blockSize * nextSlabBlocks;
+            void *slab = ::operator new(size, std::align_val_t(align));
+            slabs.push_back(slab);
+
+            bump = static_cast<std::byte *>(slab);
+            bumpLeft = nextSlabBlocks;
+            nextSlabBlocks = std::min(nextSlabBlocks * 2, MaxSlabBlocks);
+
+            stats.slabs++;
+            stats.bytes += size;
+        }
+
+        public:
+        SlabPool(size_t size, size_t align) :
+            align(std::max(align, alignof(FreeBlock))),
+            blockSize((std::max(size, sizeof(FreeBlock)) + this->align - 1) / this->align * this->align) {}
+
+        SlabPool(SlabPool const &copy) = delete;
+
+        ~SlabPool() {
+            for (void *slab : slabs)
+                ::operator delete(slab, std::align_val_t(align));
+        }
+
+        /// Uninitialized storage for one block. Throws `std::bad_alloc` like `new`.
+        void *Allocate() {
+            void *block;
+            if (freeList) {
+                block = freeList;
+                freeList = freeList->next;
+                stats.reused++;
+            } else {
+                if (bumpLeft == 0)
+                    Grow();
+                block = bump;
+                bump += blockSize;
+                bumpLeft--;
+            }
+
+            stats.allocations++;
+            stats.live++;
+            stats.peak = std::max(stats.peak, stats.live);
+            return block;
+        }
+
+        /// Takes back a block from `Allocate`, whose object has already been destroyed.
+        void Free(void *block) {
+            freeList = new (block) FreeBlock {freeList};
+            stats.live--;
+        }
+
+        Stats const &GetStats() const {
+            return stats;
+        }
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "qjs/mappedfile.hpp"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace Qjs {
+    struct Context;
+
+    /// JS source text, handed to QuickJS without copying.
+    /// It's always zero terminated, since that's what `JS_Eval` expects, and may or may not own its storage.
+    /// Copies share the storage.
+    struct Source final {
+        private:
+        char const *data;
+        size_t size;
+        std::shared_ptr<void const> owner;
+
+        Source(char const *data, size_t size, std::shared_ptr<void const> &&owner) : data(data), size(size), owner(std::move(owner)) {}
+
+        public:
+        /// Borrows a zero terminated string, e.g. a literal. It has to outlive the source.
+        Source(char const *cstr) : data(cstr), size(std::strlen(cstr)) {}
+
+        /// Borrows a string. It has to outlive the source, and not be modified in the meantime.
+        Source(std::string const &str) : data(str.c_str()), size(str.size()) {}
+
+        /// Takes the string over.
+        Source(std::string &&str) {
+            auto owned = std::make_shared<std::string const>(std::move(str));
+            data = owned->c_str();
+            size = owned->size();
+            owner = std::move(owned);
+        }
+
+        /// Borrows `size` bytes at `data`. `data[size]` must be readable and zero.
+        static Source Borrow(char const *data, size_t size) {
+            return Source(data, size, nullptr);
+        }
+
+        /// String views aren't zero terminated, so they have to be copied.
+        static Source Copy(std::string_view view) {
+            return Source(std::string(view));
+        }
+
+        /// Maps a file. The mapping lives as long as the source (and its copies).
+        static std::optional<Source> Map(std::filesystem::path const &path) {
+            auto mapped = MappedFile::Open(path);
+            if (!mapped)
+                return std::nullopt;
+
+            auto file = std::make_shared<MappedFile const>(std::move(*mapped));
+            return Source(file->Data(), file->Size(), std::move(file));
+        }
+
+        char const *Data() const {
+            return data;
+        }
+
+        size_t Size() const {
+            return size;
+        }
+
+        operator std::string_view () const {
+            return {data, size};
+        }
+    };
+
+    /// A module loader that maps `path` from disk, for use with `Runtime::SetModuleLoaderFunc`.
+    inline std::optional<Source> LoadFile(Context &ctx, std::string const &path) {
+        return Source::Map(path);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "quickjs.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace Qjs {
+    /// A JS string's UTF-8 contents, borrowed from the engine. ASCII strings aren't copied at all.
+    /// It frees the buffer when it goes away, so it's meant to be taken as a native function's argument
+    /// (where it lives for the whole call) rather than kept around.
+    struct JsStringView final {
+        private:
+        JSContext *ctx = nullptr;
+        char const *data = nullptr;
+        size_t size = 0;
+
+        public:
+        /// Takes over `data`, as returned by `JS_ToCStringLen`.
+        JsStringView(JSContext *ctx, char const *data, size_t size) : ctx(ctx), data(data), size(size) {}
+
+        JsStringView(JsStringView const &copy) = delete;
+
+        JsStringView(JsStringView &&move) : ctx(move.ctx), data(std::exchange(move.data, nullptr)), size(std::exchange(move.size, 0)) {}
+
+        JsStringView &operator = (JsStringView &&move) {
+            std::swap(ctx, move.ctx);
+            std::swap(data, move.data);
+            std::swap(size, move.size);
+            return *this;
+        }
+
+        ~JsStringView() {
+            if (data)
+                JS_FreeCString(ctx, data);
+        }
+
+        char const *Data() const {
+            return data;
+        }
+
+        size_t Size() const {
+            return size;
+        }
+
+        std::string_view View() const {
+            return {data, size};
+        }
+
+        operator std::string_view () const {
+            return View();
+        }
+
+        std::string ToString() const {
+            return std::string(data, size);
+        }
+    };
+}
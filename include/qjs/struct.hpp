@@ -0,0 +1,113 @@
+#pragma once
+
+#include "qjs/context_fwd.hpp"
+#include "qjs/conversion_fwd.hpp"
+#include "qjs/propertykey.hpp"
+#include "qjs/result_fwd.hpp"
+#include "qjs/util.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <optional>
+#include <utility>
+
+namespace Qjs {
+    /// One field of a struct, exposed to JS as the property `TName`.
+    template <FixedString TName, auto TMember>
+    struct StructField;
+
+    template <FixedString TName, typename TStruct, typename TValue, TValue (TStruct::*TMember)>
+    struct StructField<TName, TMember> {
+        using Type = TValue;
+
+        static constexpr auto Member = TMember;
+
+        static PropertyKey Key(Context &ctx) {
+            return ctx.rt.Key<TName>(ctx);
+        }
+    };
+
+    template <typename ...TFields>
+    struct StructFields {};
+
+    /// Specialize this to convert a struct to and from a plain JS object:
+    ///
+    /// ```
+    /// template <>
+    /// struct Qjs::StructTraits<Point> {
+    ///     using Fields = Qjs::StructFields<
+    ///         Qjs::StructField<"x", &Point::x>,
+    ///         Qjs::StructField<"y", &Point::y>
+    ///     >;
+    /// };
+    /// ```
+    ///
+    /// Field types can be anything with a conversion, including other structs, optionals and vectors.
+    template <typename T>
+    struct StructTraits;
+
+    /// Field names are interned once per runtime (see `StaticKey`), so converting doesn't hash any strings.
+    /// Objects built from the same struct define their properties in the same order, so they all end up
+    /// sharing one shape in the engine.
+    template <typename T>
+        requires requires { typename StructTraits<T>::Fields; }
+    struct Conversion<T> final {
+        static constexpr bool Implemented = true;
+
+        using Fields = typename StructTraits<T>::Fields;
+
+        static Value Wrap(Context &ctx, T const &value) {
+            return WrapFields(ctx, value, Fields {});
+        }
+
+        static Value Wrap(Context &ctx, T &&value) {
+            return WrapFields(ctx, std::move(value), Fields {});
+        }
+
+        /// Missing properties read as `undefined`, which is fine for `std::optional` fields and an error for most others.
+        static JsResult<T> Unwrap(ValueRef value) {
+            if (!JS_IsObject(value))
+                return Value::ThrowTypeError(value.ctx, "Expected object");
+
+            return UnwrapFields(value, Fields {});
+        }
+
+        private:
+        template <typename TValue, typename ...TFields>
+        static Value WrapFields(Context &ctx, TValue &&value, StructFields<TFields...>) {
+            Value obj = Value::Object(ctx);
+            if (obj.IsException())
+                return obj;
+
+            bool ok = (... && (JS_DefinePropertyValue(ctx, obj, TFields::Key(ctx).atom,
+                Value::From(ctx, std::forward<TValue>(value).*TFields::Member).ToUnmanaged(), JS_PROP_C_W_E) >= 0));
+
+            if (!ok)
+                return Value(ctx, JS_EXCEPTION);
+
+            return obj;
+        }
+
+        template <typename ...TFields>
+        static JsResult<T> UnwrapFields(ValueRef value, StructFields<TFields...>) {
+            T out {};
+            std::optional<Value> err;
+
+            auto read = [&]<typename TField>() {
+                auto res = Value::CreateFree(value.ctx, JS_GetProperty(value.ctx, value, TField::Key(value.ctx).atom))
+                    .template As<typename TField::Type>();
+                if (!res.IsOk()) {
+                    err = std::move(res).GetErr();
+                    return false;
+                }
+
+                out.*TField::Member = std::move(res).GetOk();
+                return true;
+            };
+
+            if (!(... && read.template operator()<TFields>()))
+                return std::move(*err);
+
+            return out;
+        }
+    };
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "qjs/context_fwd.hpp"
+#include "qjs/conversion_fwd.hpp"
+#include "qjs/result_fwd.hpp"
+#include "qjs/value_fwd.hpp"
+#include "quickjs.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Qjs {
+    template <typename T>
+    struct TypedArrayTraits;
+
+    template <> struct TypedArrayTraits<int8_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_INT8; };
+    template <> struct TypedArrayTraits<uint8_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_UINT8; };
+    template <> struct TypedArrayTraits<int16_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_INT16; };
+    template <> struct TypedArrayTraits<uint16_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_UINT16; };
+    template <> struct TypedArrayTraits<int32_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_INT32; };
+    template <> struct TypedArrayTraits<uint32_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_UINT32; };
+    template <> struct TypedArrayTraits<int64_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_BIG_INT64; };
+    template <> struct TypedArrayTraits<uint64_t> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_BIG_UINT64; };
+    template <> struct TypedArrayTraits<float> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_FLOAT32; };
+    template <> struct TypedArrayTraits<double> { static constexpr JSTypedArrayEnum Type = JS_TYPED_ARRAY_FLOAT64; };
+
+    template <typename T>
+    concept TypedArrayElement = requires {
+        { TypedArrayTraits<T>::Type } -> std::convertible_to<JSTypedArrayEnum>;
+    };
+
+    /// Contiguous numeric data owned on the C++ side, which becomes the backing store of a typed array
+    /// (`Float32Array` for `float`, etc.) without being copied. `owner` is released once JS is done with the array.
+    template <TypedArrayElement T>
+    struct TypedBuffer final {
+        std::span<T> data;
+        std::shared_ptr<void> owner;
+
+        /// Takes the vector over. Its storage becomes the array's.
+        static TypedBuffer From(std::vector<T> &&vec) {
+            auto owned = std::make_shared<std::vector<T>>(std::move(vec));
+            return {std::span<T>(*owned), std::move(owned)};
+        }
+    };
+
+    struct TypedArray final {
+        /// A typed array over `size` elements at `data`. `free(rt, opaque, data)` is called once it's unreachable,
+        /// or right away if the array can't be created.
+        template <TypedArrayElement T>
+        static Value New(Context &ctx, T *data, size_t size, JSFreeArrayBufferDataFunc *free, void *opaque) {
+            JSValue buffer = JS_NewArrayBuffer(ctx, reinterpret_cast<uint8_t *>(data), size * sizeof(T), free, opaque, false);
+            if (JS_IsException(buffer)) {
+                if (free)
+                    free(ctx.rt, opaque, data);
+                return Value(ctx, JS_EXCEPTION);
+            }
+
+            std::array<JSValue, 3> args {buffer, JS_NewInt64(ctx, 0), JS_NewInt64(ctx, size)};
+            Value arr = Value::CreateFree(ctx, JS_NewTypedArray(ctx, args.size(), args.data(), TypedArrayTraits<T>::Type));
+            JS_FreeValue(ctx, buffer);
+
+            return arr;
+        }
+
+        /// The storage of a typed array with elements of type `T`. It's only valid while the array is alive
+        /// and its buffer isn't detached or resized, e.g. for the rest of a native call it was passed to.
+        template <TypedArrayElement T>
+        static JsResult<std::span<T>> Borrow(ValueRef value) {
+            if (JS_GetTypedArrayType(value) != TypedArrayTraits<T>::Type)
+                return Value::ThrowTypeError(value.ctx, "Expected typed array");
+
+            size_t offset, length, bytesPerElement;
+            JSValue buffer = JS_GetTypedArrayBuffer(value.ctx, value, &offset, &length, &bytesPerElement);
+            if (JS_IsException(buffer))
+                return Value(value.ctx, JS_EXCEPTION);
+
+            size_t size;
+            uint8_t *data = JS_GetArrayBuffer(value.ctx, &size, buffer);
+            JS_FreeValue(value.ctx, buffer);
+
+            if (!data) {
+                if (length == 0)
+                    return std::span<T>();
+                return Value(value.ctx, JS_EXCEPTION);
+            }
+
+            return std::span<T>(reinterpret_cast<T *>(data + offset), length / sizeof(T));
+        }
+    };
+
+    /// Borrowed both ways. A wrapped span's memory has to outlive every JS reference to the array,
+    /// since nothing tells C++ when those are gone; use `TypedBuffer` when that can't be guaranteed.
+    template <typename T>
+        requires TypedArrayElement<std::remove_const_t<T>>
+    struct Conversion<std::span<T>> final {
+        static constexpr bool Implemented = true;
+
+        using TElement = std::remove_const_t<T>;
+
+        static Value Wrap(Context &ctx, std::span<T> span) {
+            return TypedArray::New<TElement>(ctx, const_cast<TElement *>(span.data()), span.size(), nullptr, nullptr);
+        }
+
+        static JsResult<std::span<T>> Unwrap(ValueRef value) {
+            auto res = TypedArray::Borrow<TElement>(value);
+            if (!res.IsOk())
+                return std::move(res).GetErr();
+            return std::span<T>(std::move(res).GetOk());
+        }
+    };
+
+    /// Unwrapping copies the contents into a new buffer, since JS may still hold on to the array.
+    template <TypedArrayElement T>
+    struct Conversion<TypedBuffer<T>> final {
+        static constexpr bool Implemented = true;
+
+        static Value Wrap(Context &ctx, TypedBuffer<T> buf) {
+            auto owner = new std::shared_ptr<void>(std::move(buf.owner));
+            return TypedArray::New<T>(ctx, buf.data.data(), buf.data.size(), [](JSRuntime *rt, void *opaque, void *ptr) {
+                delete static_cast<std::shared_ptr<void> *>(opaque);
+            }, owner);
+        }
+
+        static JsResult<TypedBuffer<T>> Unwrap(ValueRef value) {
+            auto res = TypedArray::Borrow<T>(value);
+            if (!res.IsOk())
+                return std::move(res).GetErr();
+
+            auto span = std::move(res).GetOk();
+            return TypedBuffer<T>::From(std::vector<T>(span.begin(), span.end()));
+        }
+    };
+}
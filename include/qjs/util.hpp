@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <typeinfo>
 
 #ifndef _WIN32
@@ -32,4 +35,33 @@ namespace Qjs {
     }
     template <typename T>
     void Void() {}
+
+    /// 64-bit FNV-1a. Pass the previous result as `seed` to hash several buffers as one.
+    inline uint64_t Fnv1a(void const *data, size_t size, uint64_t seed = 0xcbf29ce484222325) {
+        auto bytes = static_cast<unsigned char const *>(data);
+        for (size_t i = 0; i < size; i++) {
+            seed ^= bytes[i];
+            seed *= 0x100000001b3;
+        }
+        return seed;
+    }
+
+    /// A string literal that can be used as a template argument, e.g. `Foo<"name">`.
+    template <size_t TSize>
+    struct FixedString final {
+        char data[TSize] {};
+
+        constexpr FixedString(char const (&str)[TSize]) {
+            for (size_t i = 0; i < TSize; i++)
+                data[i] = str[i];
+        }
+
+        constexpr std::string_view View() const {
+            return {data, TSize - 1};
+        }
+
+        constexpr char const *CStr() const {
+            return data;
+        }
+    };
 }
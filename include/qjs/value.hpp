@@ -1,27 +1,74 @@
 #pragma once
 
 #include "qjs/functionwrapper_fwd.hpp"
+#include "qjs/overloads.hpp"
+#include "qjs/result.hpp"
+#include "qjs/sharedtrampolines.hpp"
+#include "qjs/source.hpp"
 #include "quickjs.h"
 #include "value_fwd.hpp"
+#include <string>
 
 namespace Qjs {
+    template <auto TFun>
+    Value Value::Function(Context &ctx, std::string &&name) {
+#ifdef QJS_CPP_SHARED_TRAMPOLINES
+        return SharedTrampolines::Function<TFun>(ctx, name);
+#else
+        return CreateFree(ctx, JS_NewCFunction(ctx, FunctionWrapper<TFun>::Invoke, name.c_str(), FunctionWrapper<TFun>::ArgCount));
+#endif
+    }
+
+    template <auto ...TFuns>
+    Value Value::Overloads(Context &ctx, std::string &&name) {
+        return CreateFree(ctx, JS_NewCFunction(ctx, OverloadWrapper<TFuns...>::Invoke, name.c_str(), OverloadWrapper<TFuns...>::ArgCount));
+    }
+
     template <auto TGet>
     void Value::AddGetter(Context &ctx, std::string &&name) {
-        auto prop = JS_NewAtom(ctx, name.c_str());
+        auto prop = ctx.rt.Intern(ctx, name).atom;
         JS_DefinePropertyGetSet(ctx, value, prop,
+#ifdef QJS_CPP_SHARED_TRAMPOLINES
+            SharedTrampolines::Getter<TGet>(ctx, name).ToUnmanaged(),
+#else
             JS_NewCFunction(ctx, GetSetWrapper<TGet>::Get, name.c_str(), 0),
+#endif
             JS_UNDEFINED,
         JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE);
-        JS_FreeAtom(ctx, prop);
     }
 
     template <auto TGet>
     void Value::AddGetterSetter(Context &ctx, std::string &&name) {
-        auto prop = JS_NewAtom(ctx, name.c_str());
+        auto prop = ctx.rt.Intern(ctx, name).atom;
         JS_DefinePropertyGetSet(ctx, value, prop,
+#ifdef QJS_CPP_SHARED_TRAMPOLINES
+            SharedTrampolines::Getter<TGet>(ctx, name).ToUnmanaged(),
+            SharedTrampolines::Setter<TGet>(ctx, name).ToUnmanaged(),
+#else
             JS_NewCFunction(ctx, GetSetWrapper<TGet>::Get, name.c_str(), 0),
             JS_NewCFunction(ctx, GetSetWrapper<TGet>::Set, name.c_str(), 1),
+#endif
         JS_PROP_CONFIGURABLE | JS_PROP_WRITABLE | JS_PROP_ENUMERABLE);
-        JS_FreeAtom(ctx, prop);
+    }
+
+    inline Value Value::ParseJson(Context &ctx, Source const &json, std::string const &file) {
+        return CreateFree(ctx, JS_ParseJSON(ctx, json.Data(), json.Size(), file.c_str()));
+    }
+
+    inline JsResult<void> Value::ToJson(std::string &out) const {
+        Value json = CreateFree(ctx, JS_JSONStringify(ctx, value, JS_UNDEFINED, JS_UNDEFINED));
+        if (json.IsException())
+            return json;
+        if (json.value.tag != JS_TAG_STRING)
+            return ThrowTypeError(ctx, "Value has no JSON representation");
+
+        size_t size;
+        char const *data = JS_ToCStringLen(ctx, &size, json);
+        if (!data)
+            return Value(ctx, JS_EXCEPTION);
+
+        out.assign(data, size);
+        JS_FreeCString(ctx, data);
+        return {};
     }
 }
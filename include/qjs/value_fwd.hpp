@@ -14,14 +14,27 @@
 #include "context_fwd.hpp"
 #include "conversion_fwd.hpp"
 #include "qjs/functionwrapper_fwd.hpp"
+#include "qjs/propertykey.hpp"
+#include "qjs/source.hpp"
 #include "qjs/util.hpp"
 #include "quickjs.h"
 #include "result_fwd.hpp"
 
 namespace Qjs {
+#ifdef QJS_CPP_COUNT_REFS
+    /// Counts the references `Value` takes and drops. Only meant for tests.
+    struct RefCounts final {
+        inline static size_t dups = 0;
+        inline static size_t frees = 0;
+    };
+#endif
+
+    struct ValueRef;
+    struct Args;
+
     struct Value final {
         template <typename T>
-            requires (std::is_same_v<T, std::string> || std::is_same_v<T, size_t>)
+            requires (std::is_same_v<T, std::string> || std::is_same_v<T, size_t> || std::is_same_v<T, PropertyKey>)
         struct PropertyReference {
             private:
             Value const &Parent;
@@ -33,9 +46,11 @@ namespace Qjs {
             public:
             void operator = (Value &&value) {
                 if constexpr (std::is_same_v<T, std::string>)
-                    JS_SetPropertyStr(Parent.ctx, Parent, Index.c_str(), value.ToUnmanaged());
+                    JS_SetPropertyStr(Parent.ctx, Parent, Index.c_str(), std::move(value).ToUnmanaged());
+                else if constexpr (std::is_same_v<T, PropertyKey>)
+                    JS_SetProperty(Parent.ctx, Parent, Index.atom, std::move(value).ToUnmanaged());
                 else
-                    JS_SetPropertyInt64(Parent.ctx, Parent, Index, value.ToUnmanaged());
+                    JS_SetPropertyInt64(Parent.ctx, Parent, Index, std::move(value).ToUnmanaged());
             }
 
             operator Value () {
@@ -45,6 +60,8 @@ namespace Qjs {
             Value operator * () {
                 if constexpr (std::is_same_v<T, std::string>)
                     return CreateFree(Parent.ctx, JS_GetPropertyStr(Parent.ctx, Parent, Index.c_str()));
+                else if constexpr (std::is_same_v<T, PropertyKey>)
+                    return CreateFree(Parent.ctx, JS_GetProperty(Parent.ctx, Parent, Index.atom));
                 else
                     return CreateFree(Parent.ctx, JS_GetPropertyInt64(Parent.ctx, Parent, Index));
             }
@@ -53,23 +70,59 @@ namespace Qjs {
         Context &ctx;
         JSValue value;
 
-        Value(Context &ctx, JSValue value) : ctx(ctx), value(JS_DupValue(ctx, value)) {}
+        private:
+        struct Adopt {};
+
+        /// Takes over a reference the caller already owns.
+        Value(Context &ctx, JSValue value, Adopt) : ctx(ctx), value(value) {}
+
+        /// Both only count values that actually have a reference count, so dups and frees line up.
+        static JSValue Dup(Context &ctx, JSValue value) {
+#ifdef QJS_CPP_COUNT_REFS
+            if (JS_VALUE_HAS_REF_COUNT(value))
+                RefCounts::dups++;
+#endif
+            return JS_DupValue(ctx, value);
+        }
+
+        static void Free(Context &ctx, JSValue value) {
+#ifdef QJS_CPP_COUNT_REFS
+            if (JS_VALUE_HAS_REF_COUNT(value))
+                RefCounts::frees++;
+#endif
+            JS_FreeValue(ctx, value);
+        }
+
+        public:
+        Value(Context &ctx, JSValue value) : ctx(ctx), value(Dup(ctx, value)) {}
 
         Value(Value const &copy) : Value(copy.ctx, copy) {}
 
+        Value(Value &&move) : ctx(move.ctx), value(std::exchange(move.value, JS_UNDEFINED)) {}
+
+        /// Creates a value that owns `val`, without taking another reference.
         static Value CreateFree(Context &ctx, JSValue val) {
-            Value out (ctx, val);
-            JS_FreeValue(ctx, val);
-            return out;
+            return Value(ctx, val, Adopt {});
         }
 
-        void operator = (Value const &copy) {
-            this->~Value();
-            new (this) Value(copy);
+        Value &operator = (Value const &copy) {
+            if (this != &copy) {
+                this->~Value();
+                new (this) Value(copy);
+            }
+            return *this;
+        }
+
+        Value &operator = (Value &&move) {
+            if (this != &move) {
+                this->~Value();
+                new (this) Value(std::move(move));
+            }
+            return *this;
         }
 
         ~Value() {
-            JS_FreeValue(ctx, value);
+            Free(ctx, value);
         }
         
         template <typename T>
@@ -77,8 +130,8 @@ namespace Qjs {
         Value(Context &ctx, T &&value) : Value(Conversion<T>::Wrap(ctx, std::forward<T>(value))) {}
 
         template <typename T>
-        static Value From(Context &ctx, T const &value) {
-            return Conversion<T>::Wrap(ctx, value);
+        static Value From(Context &ctx, T &&value) {
+            return Conversion<std::decay_t<T>>::Wrap(ctx, std::forward<T>(value));
         }
 
         static Value Null(Context &ctx) {
@@ -102,7 +155,8 @@ namespace Qjs {
         }
 
         static Value Throw(Value err) {
-            return CreateFree(err.ctx, JS_Throw(err.ctx, err.ToUnmanaged()));
+            Context &ctx = err.ctx;
+            return CreateFree(ctx, JS_Throw(ctx, std::move(err).ToUnmanaged()));
         }
 
         static Value Global(Context &ctx) {
@@ -126,20 +180,6 @@ namespace Qjs {
         }
 
         private:
-        template <typename ...TArgs, std::size_t... TIndices>
-            requires (Conversion<TArgs>::Implemented,...)
-        static JsResult<std::tuple<TArgs...>> UnpackArgs(Context &ctx, Value thisVal, int argc, JSValue *argv, std::index_sequence<TIndices...>) {
-            std::array<Value, sizeof...(TArgs)> rawArgs {(Unit<TArgs>(Value::Undefined(ctx)))...};
-            for (size_t i = 0; i < std::min(sizeof...(TArgs), size_t(argc)); i++)
-                rawArgs[i] = Value(ctx, argv[i]);
-            try {
-                std::tuple<TArgs...> args {rawArgs[TIndices].template As<TArgs>().GetOk()...};
-                return args;
-            } catch (Value v) {
-                return v;
-            }
-        }
-
         template <auto TFun>
             requires requires (Value thisObj, std::vector<Value> params) {
                 { TFun(thisObj, params) } -> std::same_as<Value>;
@@ -151,12 +191,13 @@ namespace Qjs {
                     return JS_ThrowPlainError(__ctx, "Whar");
                 auto &ctx = *_ctx;
 
+                // The callback gets to keep its arguments, so these have to be owned.
                 Value thisVal {ctx, this_val};
-                
-                std::vector<Value> values {size_t(argc), Value::Undefined(ctx)};
 
-                for (size_t i = 0; i < values.size(); i++)
-                    values[i] = Value(ctx, argv[i]);
+                std::vector<Value> values;
+                values.reserve(argc);
+                for (int i = 0; i < argc; i++)
+                    values.emplace_back(ctx, argv[i]);
 
                 return TFun(thisVal, values).ToUnmanaged();
             }
@@ -164,9 +205,11 @@ namespace Qjs {
         public:
 
         template <auto TFun>
-        static Value Function(Context &ctx, std::string &&name) {
-            return CreateFree(ctx, JS_NewCFunction(ctx, FunctionWrapper<TFun>::Invoke, name.c_str(), FunctionWrapper<TFun>::ArgCount));
-        }
+        static Value Function(Context &ctx, std::string &&name);
+
+        /// One function backed by several C++ functions, picked by the arguments' types. See `OverloadWrapper`.
+        template <auto ...TFuns>
+        static Value Overloads(Context &ctx, std::string &&name);
 
         template <auto TFun>
             requires requires (Value thisObj, std::vector<Value> params) {
@@ -176,6 +219,19 @@ namespace Qjs {
             return CreateFree(ctx, JS_NewCFunction(ctx, RawFunctionWrapper<TFun>::Invoke, name.c_str(), FunctionWrapper<TFun>::ArgCount));
         }
 
+        /// Like the other `RawFunction`, but the callback borrows its arguments instead of getting copies,
+        /// so calls don't allocate. It's called as `TFun(thisObj, args)` or `TFun(thisObj, args, magic)`,
+        /// so one callback can back several functions that differ in `magic`.
+        template <auto TFun>
+            requires requires (ValueRef thisObj, Args args, int magic) {
+                { TFun(thisObj, args, magic) } -> std::same_as<Value>;
+            } || requires (ValueRef thisObj, Args args) {
+                { TFun(thisObj, args) } -> std::same_as<Value>;
+            }
+        static Value RawFunction(Context &ctx, std::string &&name, int length = 0, int magic = 0) {
+            return CreateFree(ctx, JS_NewCFunctionMagic(ctx, RawArgsWrapper<TFun>::Invoke, name.c_str(), length, JS_CFUNC_generic_magic, magic));
+        }
+
         template <auto TGet>
         void AddGetter(Context &ctx, std::string &&name);
 
@@ -201,7 +257,8 @@ namespace Qjs {
         template <typename TReturn, typename TThis, typename ...TArgs>
         JsResult<TReturn> InvokeThis(TThis &&_this, TArgs &&...args) {
             std::array<JSValue, sizeof...(TArgs)> argsRaw { Value::From(ctx, std::forward<TArgs>(args)).ToUnmanaged()... };
-            Value result = CreateFree(ctx, JS_Call(ctx, value, Conversion<TThis>::Wrap(_this), sizeof...(TArgs), argsRaw.data()));
+            Value thisVal = Value::From(ctx, std::forward<TThis>(_this));
+            Value result = CreateFree(ctx, JS_Call(ctx, value, thisVal, sizeof...(TArgs), argsRaw.data()));
             for (auto &arg : argsRaw)
                 JS_FreeValue(ctx, arg);
 
@@ -227,6 +284,16 @@ namespace Qjs {
                 return PropertyReference<size_t>(*this, index);
         }
 
+        auto operator [] (PropertyKey key) {
+            return PropertyReference<PropertyKey>(*this, key);
+        }
+
+        /// `value["length"_key]`. The name is only turned into an atom once per runtime.
+        template <FixedString TName>
+        auto operator [] (StaticKey<TName>) {
+            return PropertyReference<PropertyKey>(*this, ctx.rt.Key<TName>(ctx));
+        }
+
         bool IsException() {
             return JS_IsException(value);
         }
@@ -235,18 +302,14 @@ namespace Qjs {
             return value.tag == JS_TAG_NULL || value.tag == JS_TAG_UNDEFINED || value.tag == JS_TAG_UNINITIALIZED;
         }
 
-        JsResult<std::string> ToString() const {
-            auto cstr = JS_ToCString(ctx, value);
-
-            if (!cstr)
-                return Value(ctx, JS_EXCEPTION);
-
-            std::string str = cstr;
+        JsResult<std::string> ToString() const;
 
-            JS_FreeCString(ctx, cstr);
+        /// `JSON.parse`, without going through a JS call.
+        static Value ParseJson(Context &ctx, Source const &json, std::string const &file = "<json>");
 
-            return str;
-        }
+        /// `JSON.stringify` into `out`, which keeps its capacity, so one buffer can be reused for many values.
+        /// Fails with a `TypeError` for values that have no JSON form, like `undefined` or functions.
+        JsResult<void> ToJson(std::string &out) const;
 
         template <typename = void>
         std::string ExceptionMessage() {
@@ -265,7 +328,7 @@ namespace Qjs {
                     case JS_PROMISE_REJECTED: {
                         auto val = CreateFree(ctx, JS_PromiseResult(ctx, value));
 
-                        return Throw(val);
+                        return Throw(std::move(val));
                     }
                     case JS_PROMISE_PENDING:
                         ctx.ExecutePendingJob();
@@ -275,16 +338,137 @@ namespace Qjs {
             }
         }
 
-        Value Prototype() {
-            static const JSAtom JS_ATOM_prototype = JS_NewAtom(ctx, "prototype");
-            Value proto = CreateFree(ctx, JS_GetProperty(ctx, value, JS_ATOM_prototype));
+        Value Prototype();
 
-            return proto;
+        /// Creates an unmanaged value. It's up to you to manage the lifetime.
+        JSValue ToUnmanaged() const & {
+            return Dup(ctx, value);
         }
 
-        /// Creates an unmanaged value. It's up to you to manage the lifetime.
-        JSValue ToUnmanaged() const {
-            return JS_DupValue(ctx, value);
+        /// Hands this value's reference over to the caller, leaving it `undefined`.
+        JSValue ToUnmanaged() && {
+            return std::exchange(value, JS_UNDEFINED);
+        }
+    };
+
+    /// A value that's only borrowed, e.g. an argument of a native function. It doesn't take a reference,
+    /// so it's only valid as long as whatever it was borrowed from, and has to be turned into a `Value` to be kept.
+    struct ValueRef final {
+        Context &ctx;
+        JSValue value;
+
+        ValueRef(Context &ctx, JSValue value) : ctx(ctx), value(value) {}
+
+        ValueRef(Value const &value) : ctx(value.ctx), value(value.value) {}
+
+        /// Takes a reference, so the result can outlive the borrow.
+        Value ToValue() const {
+            return Value(ctx, value);
+        }
+
+        template <typename T>
+        JsResult<T> As() const {
+            return Conversion<T>::Unwrap(*this);
+        }
+
+        operator JSValue () const {
+            return value;
+        }
+
+        bool IsException() const {
+            return JS_IsException(value);
+        }
+
+        bool IsNullish() const {
+            return value.tag == JS_TAG_NULL || value.tag == JS_TAG_UNDEFINED || value.tag == JS_TAG_UNINITIALIZED;
+        }
+
+        JsResult<std::string> ToString() const {
+            size_t len;
+            auto cstr = JS_ToCStringLen(ctx, &len, value);
+
+            if (!cstr)
+                return Value(ctx, JS_EXCEPTION);
+
+            std::string str (cstr, len);
+
+            JS_FreeCString(ctx, cstr);
+
+            return str;
+        }
+
+        Value Prototype() const {
+            return Value::CreateFree(ctx, JS_GetProperty(ctx, value, ctx.rt.Key<"prototype">(ctx).atom));
         }
     };
+
+    /// The arguments of a native call, borrowed from the engine. Indexing past the end gives `undefined`, like in JS.
+    struct Args final {
+        struct Iterator {
+            Args const *args;
+            size_t index;
+
+            ValueRef operator * () const {
+                return (*args)[index];
+            }
+
+            Iterator &operator ++ () {
+                index++;
+                return *this;
+            }
+
+            bool operator == (Iterator const &other) const = default;
+        };
+
+        Context &ctx;
+
+        private:
+        int const argc;
+        JSValue *const argv;
+
+        public:
+        Args(Context &ctx, int argc, JSValue *argv) : ctx(ctx), argc(argc), argv(argv) {}
+
+        size_t Size() const {
+            return argc;
+        }
+
+        ValueRef operator [] (size_t index) const {
+            return ValueRef(ctx, index < size_t(argc) ? argv[index] : JS_UNDEFINED);
+        }
+
+        Iterator begin() const {
+            return {this, 0};
+        }
+
+        Iterator end() const {
+            return {this, Size()};
+        }
+    };
+
+    template <auto TFun>
+    struct RawArgsWrapper {
+        static JSValue Invoke(JSContext *__ctx, JSValue this_val, int argc, JSValue *argv, int magic) {
+            auto _ctx = Context::From(__ctx);
+            if (!_ctx)
+                return JS_ThrowPlainError(__ctx, "Whar");
+            auto &ctx = *_ctx;
+
+            ValueRef thisVal {ctx, this_val};
+            Args args {ctx, argc, argv};
+
+            if constexpr (requires { TFun(thisVal, args, magic); })
+                return TFun(thisVal, args, magic).ToUnmanaged();
+            else
+                return TFun(thisVal, args).ToUnmanaged();
+        }
+    };
+
+    inline JsResult<std::string> Value::ToString() const {
+        return ValueRef(*this).ToString();
+    }
+
+    inline Value Value::Prototype() {
+        return ValueRef(*this).Prototype();
+    }
 }
@@ -1,19 +1,49 @@
 #include "include/qjs.hpp"
+#include "qjs/stringview.hpp"
+#include "qjs/struct.hpp"
+#include "qjs/bundle.hpp"
+#include "qjs/bytecodecache.hpp"
 #include "qjs/class.hpp"
+#include "qjs/compiledscript.hpp"
 #include "qjs/classbuilder_fwd.hpp"
+#include "qjs/classwrapper_fwd.hpp"
+#include "qjs/containerview.hpp"
 #include "qjs/context_fwd.hpp"
+#include "qjs/contextpool.hpp"
 #include "qjs/conversion.hpp"
 #include "qjs/conversion_fwd.hpp"
 #include "qjs/function.hpp"
+#include "qjs/functionlist.hpp"
+#include "qjs/gctrace.hpp"
+#include "qjs/iterator.hpp"
+#include "qjs/msgpack.hpp"
+#include "qjs/overloads.hpp"
+#include "qjs/propertykey.hpp"
 #include "qjs/result_fwd.hpp"
 #include "qjs/runtime_fwd.hpp"
+#include "qjs/typedarray.hpp"
 #include "qjs/value_fwd.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <format>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <ranges>
 #include <ostream>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#ifdef QJS_CPP_TEST_BUNDLE
+#include "test_bundle.hpp"
+#endif
+
 #define JS_SOURCE(...) #__VA_ARGS__
 
 struct Test : public Qjs::ManagedClass {
@@ -49,6 +79,9 @@ char const Src[] = JS_SOURCE(
     test.wawa("wawa");
     let unmanaged = testFun([test, test, test, test]);
     log(unmanaged.x, unmanaged.y);
+    warn("unmanaged", unmanaged.x);
+    error("unmanaged", unmanaged.y);
+    log("same wrapper:", testFun([test]) === unmanaged);
 );
 
 char const TestModSrc[] = JS_SOURCE(
@@ -57,6 +90,11 @@ char const TestModSrc[] = JS_SOURCE(
     }
 );
 
+char const CacheSrc[] = JS_SOURCE(
+    import {wawa} from "test";
+    wawa();
+);
+
 Qjs::Value Log(Qjs::Value thisVal, std::vector<Qjs::Value> &args) {
     for (size_t i = 0; i < args.size(); i++) {
         auto strRes = args[i].ToString();
@@ -70,6 +108,26 @@ Qjs::Value Log(Qjs::Value thisVal, std::vector<Qjs::Value> &args) {
     return Qjs::Value::Undefined(thisVal.ctx);
 }
 
+enum ReportLevel {
+    Warn,
+    Error,
+};
+
+Qjs::Value Report(Qjs::ValueRef thisVal, Qjs::Args args, int level) {
+    std::print(std::cerr, "{}:\t", level == Warn ? "warning" : "error");
+
+    for (Qjs::ValueRef arg : args) {
+        auto strRes = arg.ToString();
+        if (!strRes.IsOk())
+            return strRes.GetErr();
+
+        std::print(std::cerr, "{}\t", strRes.GetOk());
+    }
+    std::println(std::cerr, "");
+
+    return Qjs::Value::Undefined(thisVal.ctx);
+}
+
 Unmanaged unmanaged {1, 2};
 
 Unmanaged *TestFun(std::vector<Qjs::RequireNonNull<Test>> t) {
@@ -77,24 +135,45 @@ Unmanaged *TestFun(std::vector<Qjs::RequireNonNull<Test>> t) {
     return &unmanaged;
 }
 
+Qjs::Object Echo(Qjs::Object obj) {
+    return obj;
+}
+
+int Add(int a, int b) {
+    return a + b;
+}
+
 std::string Normalize(Qjs::Context &ctx, std::string requesting, std::string requested) {
     return requested;
 }
 
-std::optional<std::string> Load(Qjs::Context &ctx, std::string requested) {
+size_t loadCalls = 0;
+
+std::optional<Qjs::Source> Load(Qjs::Context &ctx, std::string const &requested) {
+    loadCalls++;
     if (requested == "test")
         return TestModSrc;
     return std::nullopt;
 }
 
-void RunTest(Qjs::Runtime &rt) {
-    Qjs::Context ctx {rt};
+/// Stops the test run unless the global script `expr` evaluates to something that stringifies to `expected`.
+void Expect(Qjs::Context &ctx, std::string const &expr, std::string_view expected) {
+    auto script = Qjs::CompiledScript::Compile(ctx, "JSON.stringify(" + expr + ")", "expect.js");
+    auto res = script.IsOk() ? script.GetOk().Run() : script.GetErr();
+    std::string actual = res.IsException() ? "threw " + res.ExceptionMessage() : res.As<std::string>().OkOr("?");
+
+    if (actual != expected) {
+        std::println(std::cerr, "expected {} to be {}, got {}", expr, expected, actual);
+        std::exit(1);
+    }
+}
+
+void Setup(Qjs::Context &ctx) {
     auto global = Qjs::Value::Global(ctx);
 
     global["log"] = Qjs::Value::RawFunction<Log>(ctx, "log");
-
-    auto logfn = (*global["log"]).As<Qjs::Function<void, std::string, int>>().GetOk();
-    logfn("test!", 5);
+    global["warn"] = Qjs::Value::RawFunction<Report>(ctx, "warn", 0, Warn);
+    global["error"] = Qjs::Value::RawFunction<Report>(ctx, "error", 0, Error);
 
     auto &testMod = ctx.AddModule("#test");
 
@@ -106,6 +185,7 @@ void RunTest(Qjs::Runtime &rt) {
         .Build(testMod);
 
     Qjs::ClassBuilder<Unmanaged>(ctx, "TestUnmanaged")
+        .KeepIdentity()
         .Field<&Unmanaged::x>("x")
         .Field<&Unmanaged::y>("y")
         .Build(testMod);
@@ -113,10 +193,708 @@ void RunTest(Qjs::Runtime &rt) {
     auto &test2Mod = ctx.AddModule("#test2");
 
     global["testFun"] = Qjs::Value::Function<TestFun>(ctx, "testFun");
+}
+
+void RunTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto global = Qjs::Value::Global(ctx);
+
+    auto logfn = (*global["log"]).As<Qjs::Function<void, std::string, int>>().GetOk();
+    logfn("test!", 5).GetOk();
 
     auto result = ctx.Eval(Src, "src.js");
     if (result.IsException())
         std::println(std::cerr, "{}", ctx.Eval(Src, "src.js").ExceptionMessage());
+
+    // Arrays that claim more elements than they have fail on the first missing one.
+    Expect(ctx, "(() => { const a = []; a.length = 2 ** 32 - 1; try { testFun(a); } catch (e) { return e.name; } })()", "\"TypeError\"");
+    Expect(ctx, "(() => { const p = new Proxy([], {get: (t, k) => k == 'length' ? 2 ** 53 - 1 : undefined}); try { testFun(p); } catch (e) { return e.name; } })()", "\"TypeError\"");
+}
+
+void RunPoolTest(Qjs::Runtime &rt) {
+    Qjs::ContextPool pool {rt, 2, Setup};
+
+    {
+        auto ctx = pool.Acquire();
+        auto result = ctx->Eval(Src, "pool1.js");
+        if (result.IsException())
+            std::println(std::cerr, "{}", result.ExceptionMessage());
+
+        ctx->Eval("globalThis.leaked = 1; globalThis.log = undefined;", "pool2.js");
+    }
+
+    {
+        auto ctx = pool.Acquire();
+        Qjs::CompiledScript::Compile(*ctx, "var declared = 1;", "pool3.js").GetOk().Run();
+    }
+
+    {
+        auto a = pool.Acquire();
+        auto b = pool.Acquire();
+        auto c = pool.Acquire();
+
+        for (Qjs::Context *ctx : {&*a, &*b, &*c}) {
+            auto global = Qjs::Value::Global(*ctx);
+            std::println(std::cerr, "leaked reset: {}, log restored: {}", (*global["leaked"]).IsNullish(), JS_IsFunction(*ctx, *global["log"]));
+        }
+
+        // Kept wrappers are per context, so each one gets its own context's prototype.
+        for (Qjs::Context *ctx : {&*a, &*b})
+            ctx->Eval("log('wrapper from this context:', testFun([]) instanceof TestUnmanaged);", "pool4.js");
+    }
+
+    auto &stats = pool.GetStats();
+    std::println(std::cerr, "pool hits: {}, misses: {}, resets: {}, discarded: {}, reset time: {}ns", stats.hits, stats.misses, stats.resets, stats.discarded, stats.resetTime.count());
+}
+
+void RunCacheTest(Qjs::Runtime &rt) {
+    Qjs::BytecodeCache cache;
+    rt.SetBytecodeCache(&cache);
+
+    for (int i = 0; i < 2; i++) {
+        Qjs::Context ctx {rt};
+        Setup(ctx);
+
+        auto result = ctx.Eval(CacheSrc, "cache.js");
+        if (result.IsException())
+            std::println(std::cerr, "{}", result.ExceptionMessage());
+    }
+
+    rt.SetBytecodeCache(nullptr);
+
+    auto &stats = cache.GetStats();
+    std::println(std::cerr, "cache hits: {}, misses: {}, rejected: {}", stats.hits, stats.misses, stats.rejected);
+}
+
+void RunBundleTest(Qjs::Runtime &rt) {
+    std::vector<uint8_t> bytes;
+
+    {
+        Qjs::Context compiler {rt};
+        auto mod = compiler.Eval(TestModSrc, "test", JS_EVAL_FLAG_COMPILE_ONLY);
+
+        size_t size;
+        uint8_t *buf = JS_WriteObject(compiler, &size, mod, JS_WRITE_OBJ_BYTECODE);
+
+        Qjs::Bundle::Writer writer;
+        writer.Add("test", std::vector<uint8_t>(buf, buf + size));
+        js_free(compiler, buf);
+
+        bytes = writer.Serialize();
+    }
+
+    auto bundle = Qjs::Bundle::FromMemory(bytes);
+    if (!bundle) {
+        std::println(std::cerr, "bundle rejected");
+        return;
+    }
+
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+    ctx.AddBundle(*bundle);
+
+    size_t callsBefore = loadCalls;
+    auto result = ctx.Eval(CacheSrc, "bundle.js");
+    if (result.IsException())
+        std::println(std::cerr, "{}", result.ExceptionMessage());
+
+    std::println(std::cerr, "loader calls with bundle: {}", loadCalls - callsBefore);
+
+#ifdef QJS_CPP_TEST_BUNDLE
+    // Built by qjs_cpp_bundle from test_bundle.js.
+    auto generated = Qjs::Bundle::FromMemory(TestBundle);
+    if (!generated) {
+        std::println(std::cerr, "generated bundle rejected");
+        return;
+    }
+
+    ctx.AddBundle(*generated);
+    auto greeted = ctx.Eval(JS_SOURCE(
+        import {greet} from "greet";
+        log(greet("bundle"));
+    ), "generated.js");
+    if (greeted.IsException())
+        std::println(std::cerr, "{}", greeted.ExceptionMessage());
+#endif
+}
+
+void RunCompiledTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    Qjs::ScriptCache cache {ctx, 16};
+
+    for (int i = 0; i < 2; i++) {
+        auto script = cache.Script("log('compiled script run');", "compiled.js");
+        if (script.IsOk())
+            script.GetOk()->Run();
+    }
+
+    auto mod = cache.Script("export const x = 1;", "compiled.mjs", JS_EVAL_TYPE_MODULE);
+    if (!mod.IsOk())
+        std::println(std::cerr, "module not cached: {}", mod.GetErr().ExceptionMessage());
+
+    for (int i = 0; i < 3; i++) {
+        auto rule = cache.Function<int, int, int>("return a * b + 1;", {"a", "b"}).GetOk();
+        std::println(std::cerr, "rule({}, 3) = {}", i, rule(int(i), 3).OkOr(-1));
+    }
+
+    auto chained = cache.Function<int, int, int>("return a + b;", {"a", "b"})
+        .AndThen([](auto add) { return add(2, 3); })
+        .Transform([](int sum) { return std::to_string(sum * 2); });
+    std::println(std::cerr, "chained: {}", std::move(chained).OkOr("error"));
+
+    // A body can't close the function early and run code while it's compiled.
+    auto escaped = Qjs::CompileFunction<void>(ctx, "}), globalThis.escaped = 1, (function () {", {});
+    std::println(std::cerr, "escaping body rejected: {}", !escaped.IsOk());
+    Expect(ctx, "typeof escaped", "\"undefined\"");
+
+    auto &stats = cache.GetStats();
+    std::println(std::cerr, "script cache hits: {}, misses: {}, evictions: {}", stats.hits, stats.misses, stats.evictions);
+}
+
+void RunKeyTest(Qjs::Runtime &rt) {
+    using namespace Qjs::Literals;
+
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    global["answer"_key] = Qjs::Value::From(ctx, 42);
+    std::println(std::cerr, "answer: {}", (*global["answer"]).As<int>().OkOr(-1));
+
+    ctx.Eval("globalThis.arr = [1, 2, 3];", "keys.js");
+    Qjs::Value arr = global["arr"_key];
+    std::println(std::cerr, "arr.length: {}", (*arr["length"_key]).As<size_t>().OkOr(0));
+
+    bool same = rt.Key<"answer">(ctx).atom == rt.Intern(ctx, "answer").atom;
+    std::println(std::cerr, "interned once: {}", same);
+}
+
+double Sum(std::span<float const> samples) {
+    double sum = 0;
+    for (float sample : samples)
+        sum += sample;
+    return sum;
+}
+
+void Scale(std::span<float> samples, float factor) {
+    for (float &sample : samples)
+        sample *= factor;
+}
+
+void RunTypedArrayTest(Qjs::Runtime &rt) {
+    size_t released = 0;
+
+    {
+        Qjs::Context ctx {rt};
+        Setup(ctx);
+
+        auto global = Qjs::Value::Global(ctx);
+        global["sum"] = Qjs::Value::Function<Sum>(ctx, "sum");
+        global["scale"] = Qjs::Value::Function<Scale>(ctx, "scale");
+
+        auto samples = std::make_shared<std::vector<float>>(std::vector<float> {1, 2, 3, 4});
+        std::shared_ptr<void> owner {samples.get(), [samples, &released](void *) mutable {
+            released++;
+            samples.reset();
+        }};
+        global["samples"] = Qjs::Value::From(ctx, Qjs::TypedBuffer<float> {std::span<float>(*samples), std::move(owner)});
+
+        ctx.Eval("scale(samples, 2); log('sum', sum(samples), samples instanceof Float32Array);", "typedarray.js");
+        std::println(std::cerr, "scaled in place: {}", (*samples)[3]);
+
+        ctx.Eval("try { sum(new Int32Array(4)); } catch (e) { log(e.message); }", "typedarray.js");
+    }
+
+    rt.Gc();
+    std::println(std::cerr, "buffer released: {}", released);
+}
+
+size_t CountA(Qjs::JsStringView str) {
+    size_t count = 0;
+    for (char c : str.View())
+        count += c == 'a';
+    return count;
+}
+
+std::u16string Reverse16(std::u16string str) {
+    return std::u16string(str.rbegin(), str.rend());
+}
+
+void RunStringTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto global = Qjs::Value::Global(ctx);
+    global["countA"] = Qjs::Value::Function<CountA>(ctx, "countA");
+    global["reverse16"] = Qjs::Value::Function<Reverse16>(ctx, "reverse16");
+    global["greeting"] = Qjs::Value::From(ctx, "banana");
+    global["view"] = Qjs::Value::From(ctx, std::string_view("nul\0inside", 10));
+
+    ctx.Eval("log(countA(greeting), reverse16('h\u00e9llo w\u00f6rld'), view.length);", "strings.js");
+
+    // Lone surrogates, both from JS and from C++.
+    ctx.Eval(JS_SOURCE(
+        const lone = "\uD800x";
+        log(reverse16(lone) === "x\uD800", reverse16(reverse16(lone)) === lone);
+    ), "surrogates.js");
+
+    std::u16string lone {char16_t(0xdc00), u'x', char16_t(0xd800)};
+    auto back = Qjs::Value::From(ctx, lone).As<std::u16string>();
+    std::println(std::cerr, "lone surrogates round trip: {}", back.IsOk() && back.GetOk() == lone);
+}
+
+struct Point {
+    double x, y;
+};
+
+struct Shape {
+    std::string name;
+    std::vector<Point> points;
+    std::optional<Point> center;
+};
+
+template <>
+struct Qjs::StructTraits<Point> {
+    using Fields = Qjs::StructFields<
+        Qjs::StructField<"x", &Point::x>,
+        Qjs::StructField<"y", &Point::y>
+    >;
+};
+
+template <>
+struct Qjs::StructTraits<Shape> {
+    using Fields = Qjs::StructFields<
+        Qjs::StructField<"name", &Shape::name>,
+        Qjs::StructField<"points", &Shape::points>,
+        Qjs::StructField<"center", &Shape::center>
+    >;
+};
+
+Shape Translate(Shape shape, Point by) {
+    for (auto &point : shape.points) {
+        point.x += by.x;
+        point.y += by.y;
+    }
+    return shape;
+}
+
+double Halve(double x) {
+    return x / 2;
+}
+
+void RunNumberTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto global = Qjs::Value::Global(ctx);
+    global["halve"] = Qjs::Value::Function<Halve>(ctx, "halve");
+    global["third"] = Qjs::Value::From(ctx, 1.0f / 3);
+
+    // None of these fit in an int64_t without losing something.
+    ctx.Eval(JS_SOURCE(
+        log(halve(3), halve(-1), halve(1e300), halve(Infinity), Number.isNaN(halve(NaN)), third);
+    ), "numbers.js");
+}
+
+void RunStructTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto global = Qjs::Value::Global(ctx);
+    global["translate"] = Qjs::Value::Function<Translate>(ctx, "translate");
+    global["square"] = Qjs::Value::From(ctx, Shape {"square", {{0, 0}, {1, 0}, {1, 1}, {0, 1}}, Point {0.5, 0.5}});
+
+    ctx.Eval(JS_SOURCE(
+        const moved = translate(square, {x: 1, y: 2});
+        log(moved.name, JSON.stringify(moved.points), moved.center.x);
+        globalThis.bad = {name: "bad", points: [{x: 1}]};
+    ), "struct.js");
+
+    auto bad = (*global["bad"]).As<Shape>();
+    std::println(std::cerr, "missing field rejected: {}", !bad.IsOk());
+}
+
+void RunSerializeTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto doc = Qjs::Value::ParseJson(ctx, R"({"n": -3, "big": 5000000000, "f": 1.5, "s": "h\u00e9", "a": [true, null, {}]})");
+
+    std::string json;
+    doc.ToJson(json).GetOk();
+
+    std::vector<uint8_t> packed;
+    Qjs::MsgPack::Encode(doc, packed).GetOk();
+
+    std::string roundTrip;
+    Qjs::MsgPack::Decode(ctx, packed).ToJson(roundTrip).GetOk();
+    std::println(std::cerr, "{} ({} bytes packed), round trip equal: {}", json, packed.size(), json == roundTrip);
+
+    std::vector<uint8_t> truncated (packed.begin(), packed.end() - 1);
+    auto bad = Qjs::MsgPack::Decode(ctx, truncated);
+    std::println(std::cerr, "truncated input rejected: {}", bad.IsException() && !bad.ExceptionMessage().empty());
+}
+
+void RunContainerViewTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto points = std::make_shared<std::vector<Point>>();
+    for (int i = 0; i < 100'000; i++)
+        points->push_back({double(i), double(-i)});
+
+    auto counts = std::make_shared<std::unordered_map<std::string, int>>();
+    counts->insert({"a", 1});
+
+    auto global = Qjs::Value::Global(ctx);
+    global["points"] = Qjs::Value::From(ctx, Qjs::ContainerView<std::vector<Point>> {points});
+    global["counts"] = Qjs::Value::From(ctx, Qjs::ContainerView<std::unordered_map<std::string, int>, true> {counts});
+
+    ctx.Eval(JS_SOURCE(
+        log(points.length, points[99999].y, points.slice(1, 3).map(p => p.x), 5 in points, points[100000]);
+        try { (() => { "use strict"; points[0] = {x: 1, y: 1}; })(); } catch (e) { log(e.message); }
+        counts.b = 2;
+        counts.a += 10;
+        delete counts.missing;
+        log(JSON.stringify(counts), Object.keys(counts).length);
+    ), "containerview.js");
+
+    Expect(ctx, "[points.length, points[99999].y, points.slice(1, 3).map(p => p.x), 5 in points, points[100000] === undefined]", "[100000,-99999,[1,2],true,true]");
+    Expect(ctx, "['01' in points, '-0' in points, '1.0' in points, '4294967295' in points]", "[false,false,false,false]");
+    Expect(ctx, "[counts.a, counts.b, Object.keys(counts).length]", "[11,2,2]");
+
+    // Views made after a script replaces `Array` still get the real prototype.
+    ctx.Eval(JS_SOURCE(globalThis.Array = undefined;), "containerview_shadow.js");
+    global["again"] = Qjs::Value::From(ctx, Qjs::ContainerView<std::vector<Point>> {points});
+    ctx.Eval(JS_SOURCE(log(again.slice(0, 2).length);), "containerview_again.js");
+    Expect(ctx, "again.slice(0, 2).map(p => p.x)", "[0,1]");
+
+    std::println(std::cerr, "written through: a={} b={}", counts->at("a"), counts->at("b"));
+}
+
+auto Squares(int n) {
+    return Qjs::RangeIterator {std::views::iota(0, n) | std::views::transform([](int i) { return i * i; })};
+}
+
+#ifdef __cpp_lib_generator
+std::generator<int> Countdown(int from) {
+    for (int i = from; i > 0; i--)
+        co_yield i;
+}
+#endif
+
+int SumFirst(Qjs::JsIterable<int> items, int count) {
+    int sum = 0;
+    for (auto &item : items) {
+        if (count-- == 0)
+            break;
+        sum += item.GetOk();
+    }
+    return sum;
+}
+
+void RunIteratorTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto global = Qjs::Value::Global(ctx);
+    global["squares"] = Qjs::Value::Function<Squares>(ctx, "squares");
+    global["sumFirst"] = Qjs::Value::Function<SumFirst>(ctx, "sumFirst");
+
+    ctx.Eval(JS_SOURCE(
+        function* naturals() {
+            try {
+                for (let i = 1; ; i++)
+                    yield i;
+            } finally {
+                log("generator closed");
+            }
+        }
+        log(sumFirst(naturals(), 4), sumFirst([1, 2, 3], 10), sumFirst(new Set([5, 6]), 10));
+
+        const seen = [];
+        for (const square of squares(1000000000)) {
+            if (seen.length == 3)
+                break;
+            seen.push(square);
+        }
+        log([...squares(5)], seen, Object.keys(Object.getPrototypeOf(squares(1))).length);
+    ), "iterator.js");
+
+#ifdef __cpp_lib_generator
+    global["countdown"] = Qjs::Value::Function<Countdown>(ctx, "countdown");
+    ctx.Eval(JS_SOURCE(
+        const it = countdown(3);
+        log([...it], it.next().done);
+    ), "generator.js");
+#endif
+}
+
+struct Vec2 : public Qjs::ManagedClass {
+    double x, y;
+
+    Vec2(double x, double y) : x(x), y(y) {}
+
+    double Sum() {
+        return x + y;
+    }
+
+    double Dot(Qjs::RequireNonNull<Vec2> other) {
+        return x * other->x + y * other->y;
+    }
+
+    double Scale(double k) {
+        return (x + y) * k;
+    }
+
+    std::string Label(Qjs::JsStringView prefix) {
+        return std::format("{}({}, {})", prefix.View(), x, y);
+    }
+};
+
+template <>
+struct Qjs::ClassAllocTraits<Vec2> {
+    static constexpr bool Pooled = true;
+};
+
+void RunSlabTest(Qjs::Runtime &rt) {
+    {
+        Qjs::Context ctx {rt};
+        Setup(ctx);
+
+        Qjs::ClassBuilder<Vec2>(ctx, "Vec2")
+            .Ctor<double, double>()
+            .Field<&Vec2::x>("x")
+            .Field<&Vec2::y>("y")
+            .Build(Qjs::Value::Global(ctx));
+
+        ctx.Eval(JS_SOURCE(
+            let sum = 0;
+            for (let i = 0; i < 10000; i++)
+                sum += new Vec2(i, 1).x;
+            log(sum);
+        ), "slab.js");
+    }
+    rt.Gc();
+
+    auto &stats = Qjs::ClassWrapper<Vec2>::Pool(rt).GetStats();
+    std::println(std::cerr, "live {}, peak {}, reused {} of {}, {} slabs", stats.live, stats.peak, stats.reused, stats.allocations, stats.slabs);
+}
+
+void RunFunctionListTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    Qjs::ClassBuilder<Vec2>(ctx, "Vec2")
+        .Ctor<double, double>()
+        .Members<
+            Qjs::FieldEntry<"x", &Vec2::x>,
+            Qjs::FieldEntry<"y", &Vec2::y>,
+            Qjs::MethodEntry<"sum", &Vec2::Sum>,
+            Qjs::ConstantEntry<"dims", 2>,
+            Qjs::ConstantEntry<"big", std::numeric_limits<uint64_t>::max()>,
+            Qjs::StringConstantEntry<"kind", "vector">
+        >()
+        .Build(Qjs::Value::Global(ctx));
+
+    ctx.Eval(JS_SOURCE(
+        const v = new Vec2(1, 2);
+        v.x = 5;
+        log(v.sum(), v.x, v.dims, v.big, v.kind, Object.keys(v).length);
+    ), "functionlist.js");
+}
+
+void RunOverloadTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    Qjs::ClassBuilder<Vec2>(ctx, "Vec2")
+        .Ctor<double, double>()
+        .Overloads<&Vec2::Dot, &Vec2::Scale, &Vec2::Label>("mix")
+        .Build(Qjs::Value::Global(ctx));
+
+    ctx.Eval(JS_SOURCE(
+        const v = new Vec2(1, 2);
+        log(v.mix(new Vec2(3, 4)), v.mix(2), v.mix("v"), v.mix(2, "ignored"));
+        try {
+            v.mix({});
+        } catch (e) {
+            log(e.message);
+        }
+    ), "overload.js");
+}
+
+struct Tagged {
+    int tag = 7;
+};
+
+struct Animal : public Qjs::ManagedClass {
+    std::string name;
+
+    Animal(std::string name) : name(std::move(name)) {}
+
+    std::string Speak() {
+        return name + " makes a sound";
+    }
+};
+
+struct Dog : public Tagged, public Animal {
+    Dog(std::string name) : Animal(std::move(name)) {}
+
+    std::string Fetch() {
+        return std::format("{} fetches (tag {})", name, tag);
+    }
+};
+
+struct Puppy : public Dog {
+    using Dog::Dog;
+};
+
+std::string Introduce(Qjs::RequireNonNull<Animal> animal) {
+    return "this is " + animal->name;
+}
+
+void RunInheritanceTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    auto global = Qjs::Value::Global(ctx);
+
+    Qjs::ClassBuilder<Animal>(ctx, "Animal")
+        .Ctor<std::string>()
+        .Field<&Animal::name>("name")
+        .Method<&Animal::Speak>("speak")
+        .Build(global);
+
+    Qjs::ClassBuilder<Dog>(ctx, "Dog")
+        .Inherits<Animal>()
+        .Ctor<std::string>()
+        .Method<&Dog::Fetch>("fetch")
+        .Build(global);
+
+    Qjs::ClassBuilder<Puppy>(ctx, "Puppy")
+        .Inherits<Dog>()
+        .Ctor<std::string>()
+        .Build(global);
+
+    global["introduce"] = Qjs::Value::Function<Introduce>(ctx, "introduce");
+
+    ctx.Eval(JS_SOURCE(
+        const dog = new Dog("Rex");
+        const puppy = new Puppy("Bit");
+        puppy.name = "Bitsy";
+        log(dog.speak(), dog.fetch(), introduce(dog), introduce(puppy), puppy.fetch());
+        log(puppy instanceof Animal, puppy instanceof Dog, dog instanceof Puppy);
+        try {
+            introduce({});
+        } catch (e) {
+            log(e.message);
+        }
+    ), "inheritance.js");
+
+    // `Animal` was only built in `ctx`, so it can't be a base in `other` yet.
+    Qjs::Context other {rt};
+    try {
+        Qjs::ClassBuilder<Dog>(other, "Dog").Inherits<Animal>();
+    } catch (std::logic_error const &e) {
+        std::println(std::cerr, "unbuilt base: {}", e.what());
+    }
+}
+
+struct Holder : public Qjs::ManagedClass {
+    inline static size_t alive = 0;
+
+    std::optional<Qjs::Value> callback;
+    std::vector<Qjs::Value> items;
+    std::unordered_map<std::string, Qjs::Value> named;
+
+    Holder() {
+        alive++;
+    }
+
+    Holder(Holder const &copy) : callback(copy.callback), items(copy.items), named(copy.named) {
+        alive++;
+    }
+
+    ~Holder() {
+        alive--;
+    }
+
+    void OnEvent(Qjs::Object cb) {
+        callback = cb.value;
+    }
+
+    void Push(Qjs::Object item) {
+        items.push_back(item.value);
+    }
+
+    void Name(std::string key, Qjs::Object item) {
+        named.insert_or_assign(std::move(key), item.value);
+    }
+};
+
+void RunTraceTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    Setup(ctx);
+
+    Qjs::ClassBuilder<Holder>(ctx, "Holder")
+        .Ctor<>()
+        .Traced<&Holder::callback, &Holder::items, &Holder::named>()
+        .Method<&Holder::OnEvent>("onEvent")
+        .Method<&Holder::Push>("push")
+        .Method<&Holder::Name>("name")
+        .Build(Qjs::Value::Global(ctx));
+
+    ctx.Eval(JS_SOURCE(
+        for (let i = 0; i < 100; i++) {
+            const holder = new Holder();
+            holder.onEvent(() => holder);
+            holder.push({ holder });
+            holder.name("self", holder);
+        }
+    ), "trace.js");
+
+    size_t before = Holder::alive;
+    rt.Gc();
+    std::println(std::cerr, "holders in cycles: {} before GC, {} after", before, Holder::alive);
+}
+
+void RunRefCountTest(Qjs::Runtime &rt) {
+    Qjs::Context ctx {rt};
+    auto global = Qjs::Value::Global(ctx);
+
+    global["add"] = Qjs::Value::Function<Add>(ctx, "add");
+    global["echo"] = Qjs::Value::Function<Echo>(ctx, "echo");
+
+    constexpr size_t Calls = 1000;
+
+    auto count = [&](std::string const &src) {
+        size_t dups = Qjs::RefCounts::dups, frees = Qjs::RefCounts::frees;
+        ctx.Eval(src, "refcount.js");
+        return std::pair {Qjs::RefCounts::dups - dups, Qjs::RefCounts::frees - frees};
+    };
+
+    auto [loopDups, loopFrees] = count(std::format("for (let i = 0; i < {}; i++) {{}}", Calls));
+    auto [callDups, callFrees] = count(std::format("for (let i = 0; i < {}; i++) add(i, i);", Calls));
+
+    std::println(std::cerr, "JS -> C++ call: {} dups, {} frees", double(callDups - loopDups) / Calls, double(callFrees - loopFrees) / Calls);
+
+    // Ints have no reference count, so this is the one that shows the object path.
+    auto [objLoopDups, objLoopFrees] = count(std::format("const o = {{}}; for (let i = 0; i < {}; i++) {{}}", Calls));
+    auto [echoDups, echoFrees] = count(std::format("const o = {{}}; for (let i = 0; i < {}; i++) echo(o);", Calls));
+
+    std::println(std::cerr, "JS -> C++ call with an object: {} dups, {} frees", double(echoDups - objLoopDups) / Calls, double(echoFrees - objLoopFrees) / Calls);
+
+    auto add = (*global["add"]).As<Qjs::Function<int, int, int>>().GetOk();
+
+    size_t dups = Qjs::RefCounts::dups, frees = Qjs::RefCounts::frees;
+    for (size_t i = 0; i < Calls; i++)
+        add(1, 2).GetOk();
+
+    std::println(std::cerr, "C++ -> JS call: {} dups, {} frees", double(Qjs::RefCounts::dups - dups) / Calls, double(Qjs::RefCounts::frees - frees) / Calls);
 }
 
 int main(int argc, char **argv) {
@@ -127,6 +905,60 @@ int main(int argc, char **argv) {
     rt.Gc();
     std::println(std::cerr, "test 2 begin");
     RunTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "pool test begin");
+    RunPoolTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "cache test begin");
+    RunCacheTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "bundle test begin");
+    RunBundleTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "compiled test begin");
+    RunCompiledTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "refcount test begin");
+    RunRefCountTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "key test begin");
+    RunKeyTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "typed array test begin");
+    RunTypedArrayTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "string test begin");
+    RunStringTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "number test begin");
+    RunNumberTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "struct test begin");
+    RunStructTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "serialize test begin");
+    RunSerializeTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "container view test begin");
+    RunContainerViewTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "iterator test begin");
+    RunIteratorTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "slab test begin");
+    RunSlabTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "function list test begin");
+    RunFunctionListTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "overload test begin");
+    RunOverloadTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "inheritance test begin");
+    RunInheritanceTest(rt);
+    rt.Gc();
+    std::println(std::cerr, "trace test begin");
+    RunTraceTest(rt);
 
     return 0;
 }
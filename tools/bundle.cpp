@@ -0,0 +1,118 @@
+#include "qjs.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Precompiles JS modules into a bundle that `Qjs::Bundle` can load.
+//
+// qjs_cpp_bundle [--header <out.hpp> --symbol <Name>] [--bundle <out.qjsb>] <module name>=<file.js>...
+
+static bool WriteHeader(std::string const &path, std::string const &symbol, std::vector<uint8_t> const &bytes) {
+    std::ofstream out (path, std::ios::trunc);
+    if (!out)
+        return false;
+
+    std::println(out, "#pragma once");
+    std::println(out, "// Generated by qjs_cpp_bundle. Don't edit.");
+    std::println(out, "");
+    std::println(out, "#include <cstdint>");
+    std::println(out, "");
+    std::println(out, "alignas(8) inline constexpr uint8_t {}[] = {{", symbol);
+
+    for (size_t i = 0; i < bytes.size(); i++) {
+        if (i % 16 == 0)
+            std::print(out, "    ");
+        std::print(out, "0x{:02x},", bytes[i]);
+        std::print(out, "{}", i % 16 == 15 || i + 1 == bytes.size() ? "\n" : " ");
+    }
+
+    std::println(out, "}};");
+
+    return bool(out);
+}
+
+static bool WriteBundle(std::string const &path, std::vector<uint8_t> const &bytes) {
+    std::ofstream out (path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    out.write(reinterpret_cast<char const *>(bytes.data()), bytes.size());
+    return bool(out);
+}
+
+int main(int argc, char **argv) {
+    std::optional<std::string> headerPath, symbol, bundlePath;
+    std::vector<std::pair<std::string, std::string>> modules;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if ((arg == "--header" || arg == "--symbol" || arg == "--bundle") && i + 1 < argc) {
+            auto &target = arg == "--header" ? headerPath : arg == "--symbol" ? symbol : bundlePath;
+            target = argv[++i];
+            continue;
+        }
+
+        auto eq = arg.find('=');
+        if (eq == std::string_view::npos || eq == 0) {
+            std::println(std::cerr, "Expected <module name>=<file>, got '{}'", arg);
+            return 1;
+        }
+
+        modules.emplace_back(arg.substr(0, eq), arg.substr(eq + 1));
+    }
+
+    if ((!headerPath && !bundlePath) || (headerPath && !symbol)) {
+        std::println(std::cerr, "Usage: {} [--header <out.hpp> --symbol <Name>] [--bundle <out.qjsb>] <module name>=<file.js>...", argv[0]);
+        return 1;
+    }
+
+    Qjs::Runtime rt;
+    Qjs::Context ctx {rt};
+    Qjs::Bundle::Writer writer;
+
+    for (auto &[name, path] : modules) {
+        auto src = Qjs::Source::Map(path);
+        if (!src) {
+            std::println(std::cerr, "Couldn't read {}", path);
+            return 1;
+        }
+
+        auto mod = ctx.Eval(*src, name, JS_EVAL_FLAG_COMPILE_ONLY);
+        if (mod.IsException()) {
+            std::println(std::cerr, "{}: {}", path, mod.ExceptionMessage());
+            return 1;
+        }
+
+        size_t size;
+        uint8_t *buf = JS_WriteObject(ctx, &size, mod, JS_WRITE_OBJ_BYTECODE);
+        if (!buf) {
+            auto err = Qjs::Value::CreateFree(ctx, JS_GetException(ctx));
+            std::println(std::cerr, "{}: {}", path, err.ToString().OkOr("Unknown error."));
+            return 1;
+        }
+
+        writer.Add(name, std::vector<uint8_t>(buf, buf + size));
+        js_free(ctx, buf);
+    }
+
+    auto bytes = writer.Serialize();
+
+    if (headerPath && !WriteHeader(*headerPath, *symbol, bytes)) {
+        std::println(std::cerr, "Couldn't write {}", *headerPath);
+        return 1;
+    }
+
+    if (bundlePath && !WriteBundle(*bundlePath, bytes)) {
+        std::println(std::cerr, "Couldn't write {}", *bundlePath);
+        return 1;
+    }
+
+    return 0;
+}